@@ -4,8 +4,12 @@ out vec4 FragColor;
 #define NUM_BARS 200
 layout(std140, binding = 0) uniform FFTBlock {
   float u_fft[200];
+  float u_chroma[12]; // energy per pitch class, C first, strongest = 1
+  vec4 u_key; // key 0-23 (-1 unknown), strength, tonic pitch class, minor
 };
 uniform float u_time;
+uniform float u_beatPhase; // 0 on each predicted beat, rising to 1; 1 with no tempo
+uniform float u_percussive; // percussive share of the spectrum, 0 to 1
 uniform sampler2D u_texture;
 
 const float PI = 3.14159265359;
@@ -40,7 +44,8 @@ void main(){
     // radial height from smoothed FFT
     int band = int(idx);
     float value = clamp(u_fft[band]*10.0, 0.0, 1.0);
-    float maxLen = 0.05 + value * 0.3;
+    float beatPulse = exp(-8.0 * u_beatPhase);
+    float maxLen = 0.05 + value * 0.3 + 0.03 * beatPulse;
 
     // radial anti-alias
     float aaRad = 0.005;
@@ -53,8 +58,14 @@ void main(){
     float mask = angularMask * innerMask * outerMask;
     if(mask < 0.01) discard;
 
-    // color & output
-    vec3 color = mix(vec3(0.2,0.6,1.0)*value,
+    // color & output, tinted towards a hue per key as it firms up
+    vec3 keyHue = 0.5 + 0.5*cos(2.0*PI*(u_key.z/12.0 + vec3(0.0,0.33,0.67)));
+    float harmony = u_key.x >= 0.0 ? clamp(u_key.y, 0.0, 1.0) : 0.0;
+    vec3 base = mix(vec3(0.2,0.6,1.0), keyHue, 0.5*harmony);
+    // drum hits flash the bars towards white
+    float flash = smoothstep(0.4, 0.8, u_percussive);
+    base = mix(base, vec3(1.0), 0.6*flash);
+    vec3 color = mix(base*value*(1.0 + 0.5*beatPulse + flash),
                      texture(u_texture, uv).rgb,
                      0.09);
     FragColor = vec4(color, mask);
@@ -7,6 +7,7 @@ uniform float u_time;
 uniform float u_bass;
 uniform float u_mid;
 uniform float u_treble;
+uniform float u_beatPhase; // 0 on each predicted beat, rising to 1; 1 with no tempo
 
 uniform sampler2D u_sceneTex;
 
@@ -31,7 +32,7 @@ float renderBlobs(vec2 uv, float time, out float id) {
         vec2 wobbledUV = uv + vec2(wobble, 0.0);
 
         float d = length(wobbledUV - pos);
-        float r = 0.07 + 0.03 * u_bass;
+        float r = 0.07 + 0.03 * u_bass + 0.015 * exp(-8.0 * u_beatPhase);
         float blob = smoothstep(r, r - 0.01, d);
 
         // FUSION time!
@@ -1,19 +1,255 @@
 #ifndef AUDIO_H
 #define AUDIO_H
-#include <portaudio.h>
 #include <fftw3.h>
+#include <array>
+#include <cstdint>
 #include <vector>
-#include <mutex>
+#include <span>
 #include <cmath>
 #include <iostream>
 #include "Camera.h"
 #include "Shader.h"
+#include "audio_source.h"
+#include "multi_resolution.h"
+#include "spectral_features.h"
+#include "spectrum_processor.h"
+#include "stft.h"
 
-void start_audio();
+void start_audio(const AudioConfig &config = {});
+
+void stop_audio();
+
+// Offline counterpart of start_audio() for rendering recorded material: no
+// source and no analysis thread. Samples pushed with feed_audio() are
+// analysed on the calling thread before it returns, so the spectrum seen
+// by the next render depends only on the file clock, never on scheduling.
+// Tear down with stop_audio().
+bool start_offline_audio(const AudioConfig &config);
+void feed_audio(const float *interleaved, size_t frames);
+
+// Rebuilds the source, FFT plans and buffers for `config` on a background
+// thread. The last spectrum stays visible until the new pipeline publishes;
+// if the source rejects the config the previous one is restored.
+void reconfigure_audio(const AudioConfig &config);
+
+bool is_reconfiguring_audio();
+
+// True after a start or reconfiguration in which no configuration, not even
+// the fallback, could be opened. Audio stays off until the next successful
+// reconfigure_audio().
+bool is_audio_stopped();
+
+AudioConfig get_audio_config();
+
+// Timing of the capture path and FFT setup, for the debug overlay.
+struct AudioStats {
+  float callback_last_us = 0.0f;
+  float callback_max_us = 0.0f;
+  uint64_t callback_count = 0;
+  uint64_t dropped_blocks = 0;
+  float plan_ms = 0.0f;
+  bool wisdom_loaded = false;
+  // Constant-Q matrix product per frame and the kernel's size
+  float cq_us = 0.0f;
+  size_t cq_nonzeros = 0;
+  // Power spectrum, mel filterbank and DCT per frame
+  float mel_us = 0.0f;
+  // Frame features (RMS, centroid, flux, ...) per frame
+  float features_us = 0.0f;
+  // Pitch tracking per frame
+  float pitch_us = 0.0f;
+  // Harmonic/percussive separation per frame
+  float hpss_us = 0.0f;
+  // Onset detection: audio-in to event-queued latency of the last onset
+  // and the worst so far (live sources only), onsets found and onsets lost
+  // because the render thread did not drain the queue.
+  float onset_latency_ms = 0.0f;
+  float onset_latency_max_ms = 0.0f;
+  uint64_t onsets = 0;
+  uint64_t onsets_dropped = 0;
+  // Current tempo estimate (0 until one is found) and its confidence
+  float tempo_bpm = 0.0f;
+  float tempo_confidence = 0.0f;
+};
+
+AudioStats get_audio_stats();
+
+// STFT framing used by the analysis thread. Changes take effect from the
+// next analysed frame.
+struct AnalysisSettings {
+  WindowType window = WindowType::Hann;
+  int hop_size = 256;
+  // Constant-Q bins per octave from C1 upwards; 0 turns the transform off.
+  int cq_bins_per_octave = 0;
+  // Mel bands (0 = off) and MFCCs computed from them (0 = off).
+  int mel_bands = 0;
+  int mfcc_coefficients = 0;
+  // Drive u_bass/u_mid/u_treble from a time-domain biquad filterbank run on
+  // every capture block instead of from FFT bins.
+  bool band_filterbank = false;
+};
+
+void set_analysis_settings(const AnalysisSettings &settings);
+
+AnalysisSettings get_analysis_settings();
+
+class SampleRing;
+
+// Raw capture stream, one plane per channel, for consumers that want
+// time-domain samples.
+const SampleRing &get_capture_ring();
 
 float get_amplitude();
 
-std::vector<float> get_fft_data();
+// BS.1770 loudness of the capture stream in LUFS, metered on every capture
+// block: the last 400 ms, the last 3 s, the gated integrated loudness
+// since the source was opened, and the gated loudness of the current
+// programme (about the last 10 s, restarted after 2 s of silence; see
+// LoudnessMeter). -100 before there is any sound.
+struct Loudness {
+  float momentary_lufs;
+  float short_term_lufs;
+  float integrated_lufs;
+  float programme_lufs;
+};
+
+Loudness get_loudness();
+
+// One published analysis result. Owned by the audio module; visualizers
+// only ever see it through a SpectrumView.
+struct SpectrumFrame {
+  uint64_t sequence = 0;
+  double timestamp = 0.0; // audio clock, seconds since capture start
+  std::vector<float> magnitudes; // downmix of all channels
+  int channels = 1;
+  // Only filled for multichannel input: per-channel spectra (channel after
+  // channel) and mid/side of the first two channels.
+  std::vector<float> channel_magnitudes;
+  std::vector<float> mid;
+  std::vector<float> side;
+  // Constant-Q magnitudes of the downmix, empty while disabled. Bin k is
+  // centred on cq_min_freq * 2^(k / cq_bins_per_octave).
+  std::vector<float> cq;
+  float cq_min_freq = 0.0f;
+  int cq_bins_per_octave = 0;
+  // Mel band energies of the downmix in dB and their MFCCs, empty while
+  // disabled.
+  std::vector<float> mel;
+  std::vector<float> mfcc;
+  // Steady-clock seconds at which the audio at `timestamp` was captured,
+  // or 0 when rendering offline. Lets the renderer extrapolate the audio
+  // clock to the moment a frame is presented.
+  double captured_at = 0.0;
+  // Multi-resolution bands, empty unless AudioConfig::multi_resolution is
+  // set: one amplitude per band and, for each, its range, FFT size and
+  // latency. Sampled from the resolution threads when this frame was made.
+  std::vector<float> bands;
+  std::vector<MultiResolutionBand> band_info;
+  // Beat prediction: audio-clock time of the next beat and the beat period
+  // in seconds (0 while no tempo is known), with the tempo confidence.
+  double next_beat = 0.0;
+  float beat_period = 0.0f;
+  float tempo_confidence = 0.0f;
+  // Scalar features of this frame's downmix
+  SpectralFeatures features;
+  // Fundamental of the downmix in Hz (0 while unvoiced) and the tracker's
+  // confidence in [0, 1], from the samples up to the end of this frame.
+  float pitch_hz = 0.0f;
+  float pitch_confidence = 0.0f;
+  // Energy per pitch class (C first) scaled so the strongest is 1, and the
+  // running key estimate: 0-11 C to B major, 12-23 C to B minor, -1 before
+  // any sound, with its profile correlation in [-1, 1].
+  std::array<float, 12> chroma{};
+  int key = -1;
+  float key_strength = 0.0f;
+  // The downmix split into sustained (harmonic) and transient (percussive)
+  // parts that sum to `magnitudes`. Onsets are detected on the percussive
+  // part. percussive_bass is its SpectralFeatures::bass level,
+  // percussive_fraction its share of the frame's magnitude.
+  std::vector<float> harmonic;
+  std::vector<float> percussive;
+  float percussive_bass = 0.0f;
+  float percussive_fraction = 0.0f;
+};
+
+struct SpectrumView {
+  uint64_t sequence;
+  double timestamp;
+  std::span<const float> magnitudes;
+  int channels;
+  std::span<const float> channel_magnitudes;
+  std::span<const float> mid;
+  std::span<const float> side;
+  std::span<const float> cq;
+  float cq_min_freq;
+  int cq_bins_per_octave;
+  std::span<const float> mel;
+  std::span<const float> mfcc;
+  double captured_at;
+  std::span<const float> bands;
+  std::span<const MultiResolutionBand> band_info;
+  double next_beat;
+  float beat_period;
+  float tempo_confidence;
+  SpectralFeatures features;
+  float pitch_hz;
+  float pitch_confidence;
+  std::array<float, 12> chroma;
+  int key;
+  float key_strength;
+  std::span<const float> harmonic;
+  std::span<const float> percussive;
+  float percussive_bass;
+  float percussive_fraction;
+
+  std::span<const float> channel(int c) const {
+    if (channels == 1)
+      return magnitudes;
+    return channel_magnitudes.subspan(c * magnitudes.size(),
+                                      magnitudes.size());
+  }
+};
+
+// Returns the newest spectrum without locking or allocating. Render thread
+// only; the view stays valid until the next call.
+SpectrumView acquire_spectrum();
+
+// A note onset or drum hit found by the analysis thread.
+struct OnsetEvent {
+  double timestamp = 0.0; // audio clock at the onset, like SpectrumFrame's
+  float strength = 0.0f;  // spectral flux over the adaptive threshold, >= 1
+};
+
+// Pops the oldest onset not yet consumed. Lock-free; render thread only.
+// Events are queued in order and none are skipped unless the queue of 256
+// overflows.
+bool poll_onset(OnsetEvent &event);
+
+// Magnitude and phase of one frequency picked with
+// set_tracked_frequencies().
+struct TrackedTone {
+  float frequency = 0.0f; // Hz
+  float magnitude = 0.0f; // a full-scale sinusoid at `frequency` reads 1
+  float phase = 0.0f;     // radians, of the newest sample
+};
+
+// Newest state of the tracked frequencies. Updated after every capture
+// block rather than every hop, with a window per frequency of eight
+// periods (at most 100 ms) instead of the FFT size.
+struct ToneView {
+  double timestamp;   // audio clock at the newest sample
+  double captured_at; // steady-clock seconds of that sample, 0 offline
+  std::span<const TrackedTone> tones;
+};
+
+// Tracks up to 16 frequencies (Hz) with sliding DFTs in the capture path,
+// replacing the previous list; an empty list turns tracking off.
+// Frequencies at or above Nyquist are dropped. UI thread only.
+void set_tracked_frequencies(std::span<const float> hz);
+
+// Returns the newest tracked frequencies without locking or allocating.
+// Render thread only; the view stays valid until the next call.
+ToneView acquire_tones();
 
 struct GooBlob {
     glm::vec2 pos;
@@ -24,21 +260,35 @@ struct GooBlob {
 class AudioPlayer {
 public:
   void initGoo();
-  void updateGoo(float dt, float bass);
+  void updateGoo(std::span<const OnsetEvent> onsets);
   void init();
   void render(float *amp, float *time, float dt, int SCR_WIDTH, int SCR_HEIGHT);
+  // Time the bar mapping took in the last render(), for the overlay.
+  float barMappingMicros() const { return barMappingUs; }
+  // Beat phase in [0, 1) given to the shaders as u_beatPhase in the last
+  // render(); 0 on the predicted beat, 1 while no tempo is known.
+  float beatPhase() const { return beatPhaseValue; }
+  // How far ahead of the captured audio the beat phase is evaluated, to
+  // cover the delay between a frame being rendered and being seen.
+  float beatLeadMs = 30.0f;
   void loadSelectedTexture();
   int shadermode;
   int selectedImage;
   std::vector<std::string> textureNames;
   std::vector<const char *> textureItems;
 private:
-  std::vector<std::pair<int,int>> barRanges;
   std::string Shaderspath, imagepath;
   Shader circleShader, barShader, extraShader, spiralShader, globShader;
   GLuint vao, vbo, imagetex, ubo_fft;
   inline static constexpr int NUM_BARS = 200;
   const float SMOOTH_FACTOR = 0.1f;
+  SpectrumProcessor spectrumProcessor{NUM_BARS};
+  // std140 FFTBlock: u_fft[NUM_BARS] and u_chroma[12], one vec4 slot per
+  // float, then the vec4 u_key
+  std::vector<float> uniformBlock = std::vector<float>(4 * (NUM_BARS + 13));
+  float barMappingUs = 0.0f;
+  float beatPhaseValue = 0.0f;
+  std::vector<OnsetEvent> onsets; // drained from the queue each render()
   std::vector<GooBlob> gooBlobs;
 };
 #endif 
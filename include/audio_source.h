@@ -0,0 +1,77 @@
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Capture and analysis parameters. All of them can be changed at runtime
+// through reconfigure_audio().
+struct AudioConfig {
+  int fft_size = 1024;
+  int sample_rate = 44100;
+  int frames_per_buffer = 256;
+  int channels = 1; // up to 8
+  // "portaudio", "file:<path.wav>" or "synth:sweep|noise|impulse"
+  std::string source = "portaudio";
+  // Paced sources (files, synth) deliver at the sample rate when true and
+  // as fast as the analysis keeps up when false. Devices ignore it.
+  bool realtime = true;
+  // Also run 8192/2048/512-point STFTs, one thread each, stitched into one
+  // log-spaced band array (see MultiResolutionAnalyser).
+  bool multi_resolution = false;
+};
+
+// Receives blocks of interleaved float frames from a source's delivery
+// thread. Must be real-time safe.
+using AudioSink = void (*)(const float *interleaved, unsigned long frames,
+                           void *user);
+
+// Where samples come from. Every backend feeds the same sink, so the ring
+// buffer and analysis pipeline behind it do not care which one is active.
+class AudioSource {
+public:
+  virtual ~AudioSource() = default;
+
+  // Prepares the source for `config`. Sources with a fixed native format
+  // (files) overwrite sample_rate and channels. Returns false, after
+  // printing why, if the config cannot be served.
+  virtual bool open(AudioConfig &config) = 0;
+  virtual bool start(AudioSink sink, void *user) = 0;
+  // Stops delivery and releases the device; no sink calls after return.
+  virtual void close() = 0;
+  virtual std::string name() const = 0;
+  // True if the source sets its own delivery rate and so honours
+  // AudioConfig::realtime; devices deliver on their hardware clock.
+  virtual bool paced() const { return false; }
+};
+
+// Builds the backend named by `spec` (see AudioConfig::source), or nullptr
+// for an unknown name.
+std::unique_ptr<AudioSource> make_audio_source(const std::string &spec);
+
+// Base for sources without a device clock: a thread renders blocks and
+// paces them against the steady clock at the configured sample rate.
+class PacedSource : public AudioSource {
+public:
+  bool start(AudioSink sink, void *user) override;
+  void close() override;
+  bool paced() const override { return true; }
+
+protected:
+  // Fills `frames` interleaved frames; returns false at end of stream.
+  virtual bool render(float *out, size_t frames) = 0;
+
+  AudioConfig config;
+
+private:
+  void run(AudioSink sink, void *user);
+
+  std::thread thread;
+  std::atomic<bool> running{false};
+  std::vector<float> block;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef BEAT_TRACKER_H
+#define BEAT_TRACKER_H
+
+#include <cstddef>
+#include <fftw3.h>
+#include <vector>
+
+// Tempo estimate and beat-phase prediction from the onset novelty stream.
+//
+// The novelty is resampled to a fixed 100 Hz envelope covering the last six
+// seconds. A few times a second its autocorrelation is computed with one
+// forward and one inverse FFT, and the strongest lag between 60 and 200 BPM,
+// weighted towards 120 BPM to settle octave ambiguity, gives the tempo.
+//
+// Beats are then predicted by a second-order phase-locked loop: a flywheel
+// of period beat_period() whose phase and period are nudged by every onset
+// that lands near a predicted beat, and whose period is pulled towards the
+// autocorrelation tempo. Because next_beat() is a prediction, visuals can
+// aim at a beat before the audio for it has even been captured.
+class BeatTracker {
+public:
+  BeatTracker() = default;
+  BeatTracker(const BeatTracker &) = delete;
+  BeatTracker &operator=(const BeatTracker &) = delete;
+  ~BeatTracker();
+
+  // Builds the FFT plans; does nothing if they exist. FFTW's planner is not
+  // thread-safe, so call this where the other plans are made, before the
+  // first add_frame().
+  void plan();
+
+  // Feeds the onset novelty of the frame at audio-clock `time` (seconds).
+  // Times must not go backwards.
+  void add_frame(double time, float novelty);
+
+  // Feeds an onset found at audio-clock `time`.
+  void add_onset(double time, float strength);
+
+  // Audio-clock time of the next predicted beat after the last frame, and
+  // the beat period in seconds; the period is 0 until a tempo is found.
+  double next_beat() const { return nextBeat; }
+  float beat_period() const { return float(period); }
+  float bpm() const { return period > 0.0 ? float(60.0 / period) : 0.0f; }
+  // Autocorrelation peak over energy at the chosen lag, in [0, 1].
+  float confidence() const { return tempoConfidence; }
+
+private:
+  void estimate_tempo();
+
+  fftwf_plan forward = nullptr;
+  fftwf_plan inverse = nullptr;
+  float *acf = nullptr;           // envelope in, autocorrelation out
+  fftwf_complex *spectrum = nullptr;
+
+  std::vector<float> envelope; // ring of the last ENVELOPE_LENGTH slots
+  size_t envelopeAt = 0;
+  size_t envelopeFilled = 0;
+  long long slot = -1; // 10 ms slot the last frame fell into
+  float slotPeak = 0.0f;
+  int slotsSinceEstimate = 0;
+
+  float tempoConfidence = 0.0f;
+  double period = 0.0;
+  double nextBeat = 0.0;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CHROMA_H
+#define CHROMA_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Twelve-bin chromagram and running key estimate.
+//
+// Each frame's spectrum is folded onto pitch classes through a map built
+// once per configuration: FFT bins go to the nearest semitone, constant-Q
+// bins to the semitones either side of them in proportion. FFT bins too
+// coarse to tell neighbouring semitones apart are left out, so small FFTs
+// only contribute their upper range. A decaying average of the chroma is
+// correlated with the Krumhansl-Kessler key profiles, rotated to all 24
+// major and minor keys.
+class Chromagram {
+public:
+  static constexpr int PITCH_CLASSES = 12;
+
+  // Maps `bins` FFT bins of an fftSize-point transform.
+  void configure_fft(int bins, int sampleRate, int fftSize);
+  // Maps constant-Q bins, bin k centred on C1 * 2^(k / binsPerOctave).
+  void configure_cq(int bins, int binsPerOctave);
+  // True if the map was built for this input.
+  bool maps(int bins, int binsPerOctave) const {
+    return bins == mappedBins && binsPerOctave == mappedBinsPerOctave;
+  }
+
+  // Folds one frame of magnitudes into `chroma` (pitch class 0 = C),
+  // scaled so the strongest class is 1, and advances the key estimate by
+  // `hopSeconds`. The running average survives reconfiguration.
+  void process(std::span<const float> magnitudes, float hopSeconds,
+               std::array<float, PITCH_CLASSES> &chroma);
+
+  // 0-11: C major to B major, 12-23: C minor to B minor, -1 before any
+  // sound.
+  int key() const { return bestKey; }
+  // Correlation of the running chroma with the key's profile, in [-1, 1].
+  float key_strength() const { return keyStrength; }
+
+private:
+  struct Entry {
+    uint32_t bin;
+    uint8_t pitchClass;
+    float weight;
+  };
+
+  void estimate_key();
+
+  std::vector<Entry> entries; // sorted by bin
+  int mappedBins = -1;
+  int mappedBinsPerOctave = -1; // 0 for FFT bins
+  std::array<double, PITCH_CLASSES> running{};
+  int bestKey = -1;
+  float keyStrength = 0.0f;
+};
+
+#endif
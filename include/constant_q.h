@@ -0,0 +1,43 @@
+#ifndef CONSTANT_Q_H
+#define CONSTANT_Q_H
+
+#include "dsp_kernels.h"
+#include <vector>
+
+// Constant-Q transform computed from an FFT frame (Brown & Puckette): bin k
+// sits at minFreq * 2^(k / binsPerOctave) and correlates the frame with a
+// Hann-windowed complex sinusoid Q periods long. Correlation is done in the
+// frequency domain against the kernel's spectrum, which is concentrated
+// around its centre frequency; only that band is kept, giving a banded
+// sparse matrix applied with one SIMD pass over the FFT output.
+//
+// Kernels longer than the FFT are truncated to it, so below
+// full_q_frequency() the bins lose resolution; larger FFT sizes push that
+// limit down.
+class ConstantQ {
+public:
+  // `window` is the analysis window already applied to the FFT input; it
+  // is folded into the normalisation so a full-scale sinusoid at a bin's
+  // centre frequency reads as amplitude 1.
+  void configure(int fftSize, int sampleRate, int binsPerOctave,
+                 const std::vector<float> &window, float minFreq = 32.703f);
+
+  // `spectrum` is the r2c output: fftSize / 2 + 1 interleaved complex
+  // values. Writes bins() magnitudes.
+  void process(const float *spectrum, float *out) const;
+
+  int bins() const { return int(rows.size()); }
+  int bins_per_octave() const { return binsPerOctave; }
+  size_t nonzeros() const { return coeffs.size() / 2; }
+  float frequency(int k) const { return centreFreqs[k]; }
+  float full_q_frequency() const { return fullQFreq; }
+
+private:
+  int binsPerOctave = 0;
+  float fullQFreq = 0.0f;
+  std::vector<SparseBand> rows;
+  std::vector<float> coeffs; // interleaved complex, conjugated on use
+  std::vector<float> centreFreqs;
+};
+
+#endif
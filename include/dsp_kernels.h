@@ -0,0 +1,116 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Hot inner loops of the analysis pipeline. Each kernel exists as a scalar
+// reference and as SSE2, AVX2 and AVX-512 versions; the widest one the CPU
+// supports is picked on first use, after checking it against the scalar
+// reference on a probe signal. PIGEON_DSP_ISA=scalar|sse2|avx2|avx512 caps
+// the choice, e.g. for benchmarking. Pointers need no particular alignment.
+// Complex input is interleaved (re, im) pairs as produced by FFTW.
+
+// out[i] = in[i] * window[i]
+void window_multiply(const float *in, const float *window, float *out,
+                     size_t n);
+
+// out[i] = scale * |c[i]|
+void complex_magnitude(const float *c, float *out, size_t n,
+                       float scale = 1.0f);
+
+// out[i] = |c[i]|^2
+void complex_power(const float *c, float *out, size_t n);
+
+// out[i] = 10 * log10(max(|c[i]|^2, floorPower)). The log is a polynomial
+// approximation accurate to about 1e-4 dB.
+void complex_db(const float *c, float *out, size_t n,
+                float floorPower = 1e-12f);
+
+// out[i] = in[i]^exponent for in[i] > 0, and 0 for in[i] <= 0. Computed
+// as exp(exponent * log(in[i])) with polynomial log and exp. The relative
+// error is about 6e-8 * (1 + |exponent * ln(in[i])|), i.e. below 1e-5 for
+// any result that is a normal float.
+void pow_positive(const float *in, float *out, size_t n, float exponent);
+
+// Sum of x[0..n). Vector versions add in a different order than the
+// scalar one, so results differ in the last bits.
+float array_sum(const float *x, size_t n);
+
+// Row of a banded sparse complex matrix: `length` coefficients stored from
+// complex index `offset` of the coefficient array, applied to x from complex
+// index `start`.
+struct SparseBand {
+  uint32_t start, length, offset;
+};
+
+// out[r] = |sum_j x[start + j] * conj(coeffs[offset + j])| for every row.
+void sparse_matvec_magnitude(const float *x, const SparseBand *rows,
+                             size_t numRows, const float *coeffs, float *out);
+
+// Real counterpart: out[r] = sum_j x[start + j] * weights[offset + j].
+void sparse_matvec(const float *x, const SparseBand *rows, size_t numRows,
+                   const float *weights, float *out);
+
+// out[i] = 10 * log10(max(p[i], floorPower)), same accuracy as complex_db.
+void power_db(const float *p, float *out, size_t n,
+              float floorPower = 1e-12f);
+
+// Bands of a biquad bank are processed this many at a time, one per SIMD
+// lane; band counts must be a multiple of it.
+constexpr int BIQUAD_LANES = 8;
+
+// Runs `bands` parallel cascades of `stages` biquads over the same input and
+// follows the amplitude of each cascade's output with a one-pole envelope
+// that uses the attack coefficient while rising and the release one while
+// falling. All arrays are band-minor, so one vector load covers a lane
+// group:
+//   coeffs    [stage][b0, b1, b2, a1, a2][band], normalised so a0 = 1
+//   state     [stage][z1, z2][band], transposed direct form II
+//   follower  [attack, release][band]
+//   envelope  [band], updated in place
+void biquad_bank_envelope(const float *in, size_t n, const float *coeffs,
+                          float *state, int stages, int bands,
+                          const float *follower, float *envelope);
+
+// Bins per partial sum written by spectral_sums().
+constexpr size_t SPECTRAL_CHUNK = 16;
+
+// Whole-spectrum sums for the frame features, all from one pass.
+struct SpectralSums {
+  float magnitude; // sum m[k]
+  float weighted;  // sum k * m[k]
+  float power;     // sum m[k]^2
+  float log_power; // sum ln(max(m[k]^2, floorPower))
+  float flux;      // sum max(m[k] - previous[k], 0)
+};
+
+// One pass over the magnitudes m[0..n) and those of the previous frame.
+// Also writes chunks[j] = sum of m over bins [16j, 16j + 16) (the last
+// chunk may be shorter), so any range sum, e.g. for rolloff or bands,
+// needs at most a chunk's worth of extra reads.
+void spectral_sums(const float *magnitudes, const float *previous, size_t n,
+                   float floorPower, float *chunks, SpectralSums &out);
+
+// Time-domain counterpart, one pass over x[0..n).
+struct SignalSums {
+  float squares;      // sum x[i]^2
+  float peak;         // max |x[i]|
+  uint32_t crossings; // i >= 1 where x[i - 1] and x[i] differ in sign bit
+};
+void signal_sums(const float *x, size_t n, SignalSums &out);
+
+// out[i] = median of rows[0][i] .. rows[8][i], by a 19-step min/max
+// network applied across SIMD lanes. Rows may be overlapping views of the
+// same array, e.g. shifted by one element each for a median along it.
+void median9(const float *const rows[9], float *out, size_t n);
+
+// Little-endian signed integer PCM to float in [-1, 1).
+void pcm16_to_float(const void *in, float *out, size_t n);
+void pcm24_to_float(const void *in, float *out, size_t n);
+void pcm32_to_float(const void *in, float *out, size_t n);
+
+// Name of the instruction set the kernels were dispatched to.
+const char *dsp_kernel_isa();
+
+#endif
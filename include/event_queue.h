@@ -0,0 +1,61 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free queue of discrete events from one producer thread to
+// one consumer thread. Unlike TripleBuffer, which only keeps the latest
+// value, every event is delivered in order. Neither side waits or
+// allocates; a push into a full queue fails and is counted, so a stalled
+// consumer costs events, never producer latency. Each side keeps a cached
+// copy of the other's index and only reloads it when the queue looks full
+// or empty, so the shared cache lines are touched about once per burst.
+template <typename T, size_t N> class EventQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be 2^k");
+
+public:
+  static constexpr size_t CACHE_LINE = 64;
+
+  // Producer side. Returns false and counts a drop if the queue is full.
+  bool push(const T &value) {
+    uint64_t t = tail_.load(std::memory_order_relaxed);
+    if (t - headCache_ == N) {
+      headCache_ = head_.load(std::memory_order_acquire);
+      if (t - headCache_ == N) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    slots_[t & (N - 1)] = value;
+    tail_.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if nothing is pending.
+  bool pop(T &value) {
+    uint64_t h = head_.load(std::memory_order_relaxed);
+    if (h == tailCache_) {
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      if (h == tailCache_)
+        return false;
+    }
+    value = slots_[h & (N - 1)];
+    head_.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Events lost to a full queue so far; any thread.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  alignas(CACHE_LINE) std::atomic<uint64_t> tail_{0};
+  uint64_t headCache_ = 0; // producer's view of head_
+  std::atomic<uint64_t> dropped_{0};
+  alignas(CACHE_LINE) std::atomic<uint64_t> head_{0};
+  uint64_t tailCache_ = 0; // consumer's view of tail_
+  alignas(CACHE_LINE) T slots_[N];
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef FFT_PLANS_H
+#define FFT_PLANS_H
+
+#include <fftw3.h>
+#include <string>
+
+// FFTW planning backed by a wisdom file in the user cache directory
+// ($XDG_CACHE_HOME/pigeon-audio, or ~/.cache/pigeon-audio). The file name
+// encodes the CPU model and FFTW build, so wisdom from another machine or
+// library version is never imported. Plans missing from the cache are
+// measured once and the cache is rewritten by save_fft_wisdom().
+
+// Returns true if wisdom for this machine was found and imported.
+bool load_fft_wisdom();
+
+// Writes the accumulated wisdom back if any new plans were measured.
+void save_fft_wisdom();
+
+// Use FFTW_PATIENT instead of FFTW_MEASURE for plans not in the cache.
+void set_fft_patient_planning(bool patient);
+
+std::string fft_wisdom_path();
+
+fftwf_plan plan_fft_r2c(int n, float *in, fftwf_complex *out);
+
+// Inverse of plan_fft_r2c, unnormalised. Overwrites `in` when executed.
+fftwf_plan plan_fft_c2r(int n, fftwf_complex *in, float *out);
+
+// `howmany` transforms of length n in one plan. Inputs are packed n floats
+// apart, outputs n / 2 + 1 complex values apart.
+fftwf_plan plan_fft_many_r2c(int n, int howmany, float *in,
+                             fftwf_complex *out);
+
+#endif
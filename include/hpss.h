@@ -0,0 +1,43 @@
+#ifndef HPSS_H
+#define HPSS_H
+
+#include <span>
+#include <vector>
+
+// Streaming harmonic/percussive separation (FitzGerald, "Harmonic/
+// percussive separation using median filtering").
+//
+// Sustained tones are smooth along time and drum hits are smooth along
+// frequency. So a median over each bin's last HISTORY frames estimates
+// the harmonic part, and a median over each frame's WIDTH neighbouring
+// bins estimates the percussive part. Soft Wiener masks built from the
+// two split the frame's magnitudes between them. The time median is
+// causal, so a new hit is percussive on the hop it arrives and nothing
+// waits for future frames. Both medians are 9-point min/max networks run
+// across SIMD lanes, a few microseconds per hop at 2048 bins.
+class HarmonicPercussiveSeparator {
+public:
+  static constexpr int HISTORY = 9; // frames in the time median
+  static constexpr int WIDTH = 9;   // bins in the frequency median
+
+  // Sizes the buffers for `bins` bins and forgets the history.
+  void configure(int bins);
+  int bins() const { return int(padded.size()) - (WIDTH - 1); }
+
+  // Splits one frame of magnitudes; `harmonic` + `percussive` equals
+  // `magnitudes` bin by bin.
+  void process(std::span<const float> magnitudes, std::span<float> harmonic,
+               std::span<float> percussive);
+
+  // Share of the last frame's magnitude that is percussive, in [0, 1].
+  float percussive_fraction() const { return percussiveFraction; }
+
+private:
+  std::vector<float> history; // HISTORY frames of `bins`, a ring
+  int newest = 0;
+  std::vector<float> padded; // frame with edge bins repeated WIDTH / 2 times
+  std::vector<float> alongTime, alongFrequency;
+  float percussiveFraction = 0.0f;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef LOUDNESS_METER_H
+#define LOUDNESS_METER_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Loudness after ITU-R BS.1770: every channel is K-weighted (a high shelf
+// for the head and a high-pass for the ear), and the mean squares of the
+// channels are summed with the standard's weights. Channels are taken in
+// WAV order: 4 are L R Ls Rs, 5 are L R C Ls Rs, and 6 to 8 are
+// L R C LFE followed by surrounds. Surrounds count 1.41, the LFE not at
+// all. The sums are kept per 100 ms block, so the 400 ms
+// momentary and 3 s short-term windows are running sums that gain one block
+// and lose one. Integrated loudness uses the two gates from the standard:
+// 400 ms windows below -70 LUFS are dropped, then those more than 10 LU
+// under the loudness of the rest. The gated windows go into a 0.1 LU
+// histogram, so the integrated value is refreshed every block for any
+// programme length.
+//
+// Integrated loudness never forgets, so after hours of input it is stuck
+// at the session average. Programme loudness is gated the same way, but
+// older windows fade out of its histogram with a PROGRAMME_SECONDS time
+// constant, and it starts over after RESET_SECONDS of gated silence, such
+// as a gap between tracks. It follows the level of the current track
+// while still averaging over its quiet and loud passages.
+class LoudnessMeter {
+public:
+  // Values returned before there is enough audio, or for silence
+  static constexpr float SILENT = -100.0f;
+
+  // Designs the filters for `sampleRate` and resets every reading.
+  void configure(int sampleRate, int channels);
+
+  // Meters a block of interleaved samples. Real-time safe: no allocation.
+  void process(const float *interleaved, size_t frames);
+
+  // Loudness in LUFS of the last 400 ms, the last 3 s, everything since
+  // configure() and the current programme, updated every 100 ms. A
+  // full-scale 1 kHz sine in one channel reads -3 LUFS.
+  float momentary() const { return momentaryLufs; }
+  float short_term() const { return shortTermLufs; }
+  float integrated() const { return integratedLufs; }
+  float programme() const { return programmeLufs; }
+
+private:
+  static constexpr int SHORT_BLOCKS = 30;  // 100 ms blocks in 3 s
+  static constexpr int MOMENTARY_BLOCKS = 4;
+  static constexpr double PROGRAMME_SECONDS = 10.0;
+  static constexpr double RESET_SECONDS = 2.0;
+
+  struct Biquad {
+    double b0, b1, b2, a1, a2;
+  };
+
+  // Windows above the absolute gate by 0.1 LU bin: weight and energy sum
+  struct GatedHistogram {
+    std::vector<double> count, energy;
+
+    void clear();
+    void add(float loudness, double meanSquare);
+    void fade(double factor);
+    // Loudness of the windows that pass the relative gate
+    float gated_loudness() const;
+  };
+
+  void finish_block();
+
+  int channels = 0;
+  Biquad shelf{}, highPass{};
+  std::vector<double> state; // two per stage per channel, transposed DF-II
+  std::vector<double> weights; // per channel
+  int blockLength = 0;
+  int blockFill = 0;
+  double blockEnergy = 0.0;
+  std::array<double, SHORT_BLOCKS> blocks{}; // mean square of each block
+  int newest = 0;
+  long long blockCount = 0;
+  double momentarySum = 0.0, shortTermSum = 0.0;
+  GatedHistogram session, recent;
+  double fade = 1.0;      // per block, for the programme histogram
+  int silentBlocks = 0;   // consecutive blocks under the absolute gate
+  float momentaryLufs = SILENT;
+  float shortTermLufs = SILENT;
+  float integratedLufs = SILENT;
+  float programmeLufs = SILENT;
+};
+
+#endif
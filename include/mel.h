@@ -0,0 +1,35 @@
+#ifndef MEL_H
+#define MEL_H
+
+#include "dsp_kernels.h"
+#include <vector>
+
+// Mel filterbank and MFCCs from an FFT power spectrum. Each triangular
+// filter is stored as the contiguous range of bins it covers, so applying
+// the bank touches every bin at most twice. MFCCs are the orthonormal
+// DCT-II of the log band energies, as in librosa's mfcc().
+class MelFilterbank {
+public:
+  // Bands are spaced evenly on the HTK mel scale between minFreq and
+  // maxFreq (0 means half the sample rate) and area-normalised, so a flat
+  // spectrum gives the same energy density in every band. `coefficients`
+  // may be 0 to skip the DCT.
+  void configure(int fftSize, int sampleRate, int bands, int coefficients,
+                 float minFreq = 20.0f, float maxFreq = 0.0f);
+
+  // `power` holds fftSize / 2 bins. Writes bands() log energies in dB and,
+  // if enabled, coefficients() MFCCs.
+  void process(const float *power, float *melDb, float *mfcc);
+
+  int bands() const { return int(filters.size()); }
+  int coefficients() const { return int(dctRows.size()); }
+
+private:
+  std::vector<SparseBand> filters;
+  std::vector<float> weights;
+  std::vector<SparseBand> dctRows;
+  std::vector<float> dct;
+  std::vector<float> energies;
+};
+
+#endif
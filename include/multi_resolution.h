@@ -0,0 +1,74 @@
+#ifndef MULTI_RESOLUTION_H
+#define MULTI_RESOLUTION_H
+
+#include "sample_ring.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Static description of one band of the stitched multi-resolution output.
+struct MultiResolutionBand {
+  float low_hz;
+  float high_hz;
+  int fft_size; // resolution the band is measured with
+  // Delay from a sound to its full effect on this band: half the window,
+  // which is where the frame is centred, plus one hop of waiting for the
+  // next frame.
+  float latency_ms;
+};
+
+// Several STFTs of different sizes over the same capture ring, each on its
+// own thread with its own cursor, stitched into one log-spaced band array.
+// Long windows resolve the bass, short ones keep transients in the treble
+// sharp: each band is taken from the shortest window that still resolves
+// it. Band values are the mean amplitude of the bins in the band, scaled so
+// that a full-scale sinusoid on a bin centre reads 1 in that bin.
+class MultiResolutionAnalyser {
+public:
+  struct Resolution {
+    int fft_size;
+    float max_hz; // highest band this resolution covers
+  };
+
+  // 8192 below 250 Hz, 2048 up to 2.5 kHz and 512 above.
+  static std::vector<Resolution> default_resolutions();
+
+  // Allocates and plans everything, so call it where FFT plans are made.
+  // Bands are `bandsPerOctave` per octave from `minHz` up to 0.45 fs.
+  MultiResolutionAnalyser(SampleRing &ring, int sampleRate, int channels,
+                          std::vector<Resolution> resolutions,
+                          int bandsPerOctave = 6, float minHz = 20.0f);
+  ~MultiResolutionAnalyser();
+  MultiResolutionAnalyser(const MultiResolutionAnalyser &) = delete;
+  MultiResolutionAnalyser &operator=(const MultiResolutionAnalyser &) = delete;
+
+  // Runs every resolution on its own thread, each skipping ahead when it
+  // falls behind the ring. Live sources only; stopped by the destructor.
+  void start();
+
+  // Without threads: analyses every frame of every resolution that ends at
+  // or before ring position `end`, so the output lines up with a frame
+  // the caller just analysed. Used when no sample may be dropped.
+  void advance_to(uint64_t end);
+
+  // Stitches the newest result of every resolution into `values`, one per
+  // band. Call from one thread only.
+  void stitch(std::vector<float> &values);
+
+  const std::vector<MultiResolutionBand> &bands() const { return bandInfo; }
+
+private:
+  struct Worker;
+
+  void run(Worker &worker);
+  void analyse(Worker &worker);
+
+  SampleRing &ring;
+  int channels;
+  std::vector<MultiResolutionBand> bandInfo;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<bool> running{false};
+};
+
+#endif
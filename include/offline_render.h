@@ -0,0 +1,30 @@
+#ifndef OFFLINE_RENDER_H
+#define OFFLINE_RENDER_H
+
+#include <string>
+
+enum class FrameFormat { Raw, Png, Y4m };
+
+// Settings of a headless render: a WAV file in, one image per video frame
+// out.
+struct OfflineRenderOptions {
+  std::string input;  // WAV file
+  std::string output; // .rgba / .y4m file, or directory for PNG frames
+  FrameFormat format = FrameFormat::Png;
+  int width = 1280;
+  int height = 720;
+  int fps = 60;
+  int shadermode = 0;
+  int fft_size = 1024;
+  bool multi_resolution = false;
+};
+
+// Renders `options.input` with the selected visualizer into an offscreen
+// framebuffer on a surfaceless EGL context, so no window or display server
+// is needed; with Mesa's llvmpipe it also runs on machines without a GPU.
+// Analysis is driven by the file clock, one video frame at a time, and runs
+// as fast as the renderer allows. Prints the achieved frame rate. Returns
+// the process exit code.
+int run_offline_render(const OfflineRenderOptions &options);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef ONSET_DETECTOR_H
+#define ONSET_DETECTOR_H
+
+#include <optional>
+#include <span>
+#include <vector>
+
+// Spectral-flux onset detector (Dixon, "Onset detection revisited"). Each
+// frame's magnitudes are cube-root compressed and the novelty is the mean
+// rise over the previous frame, counting increases only. A frame is an
+// onset when its novelty is a local peak above an adaptive threshold, a
+// multiple of the mean novelty over the last second plus a small floor, and
+// at least MIN_INTERVAL after the previous onset.
+//
+// Peak picking needs one frame of lookahead, so an onset is reported one
+// hop after the frame that contains it.
+class OnsetDetector {
+public:
+  struct Onset {
+    int framesAgo; // 1: the frame before the one just processed
+    float strength; // novelty over threshold, >= 1
+  };
+
+  // `amplitudeScale` maps magnitudes to full-scale amplitude so the floor
+  // means the same for every window and FFT size. Resets all history.
+  void configure(int bins, float hopSeconds, float amplitudeScale);
+
+  // Feeds one frame of bins() magnitudes.
+  std::optional<Onset> process(std::span<const float> magnitudes);
+
+  // Novelty of the frame last passed to process().
+  float novelty() const { return lastNovelty; }
+  int bins() const { return int(previous.size()); }
+  float hop_seconds() const { return hopSeconds; }
+
+private:
+  float hopSeconds = 0.0f;
+  float scale = 1.0f;
+  std::vector<float> compressed;
+  std::vector<float> previous;
+  // Novelty of the last `window` frames, as a ring with a running sum
+  std::vector<float> history;
+  size_t historyAt = 0;
+  double historySum = 0.0;
+  int framesSeen = 0;
+  float lastNovelty = 0.0f;
+  float lastThreshold = 0.0f;
+  bool rising = false;
+  int framesSinceOnset = 0;
+  int minIntervalFrames = 1;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef PITCH_TRACKER_H
+#define PITCH_TRACKER_H
+
+#include <fftw3.h>
+#include <vector>
+
+// Monophonic pitch from raw samples with YIN (de Cheveigné and Kawahara,
+// "YIN, a fundamental frequency estimator for speech and music").
+//
+// The difference function d(tau) = sum (x[j] - x[j + tau])^2 over a window
+// of W samples expands into two energies and a cross-correlation. The
+// energies come from running sums and the correlation from two forward
+// FFTs and one inverse, so a frame costs O(N log N) rather than O(W^2).
+// d is then normalised by its cumulative mean. The first dip below
+// THRESHOLD, followed to its minimum and refined by parabolic
+// interpolation, gives the period.
+//
+// Lags cover 60 Hz to 1.5 kHz: the range of the singing voice and most
+// melodic instruments, with W equal to the longest lag.
+class PitchTracker {
+public:
+  PitchTracker() = default;
+  PitchTracker(const PitchTracker &) = delete;
+  PitchTracker &operator=(const PitchTracker &) = delete;
+  ~PitchTracker();
+
+  // Sizes the window for `sampleRate` and builds the FFT plans, keeping
+  // the existing ones if the size is unchanged. FFTW's planner is not
+  // thread-safe, so call this where the other plans are made.
+  void plan(int sampleRate);
+
+  // Samples one estimate looks at, ending at the newest.
+  int frame_length() const { return window + maxLag; }
+
+  // Estimates the pitch of frame_length() mono samples.
+  void process(const float *samples);
+
+  // Fundamental in Hz, 0 while unvoiced or too quiet.
+  float frequency() const { return f0; }
+  // 1 minus the normalised difference at the chosen lag: near 1 for a
+  // clean periodic signal, low for noise and chords.
+  float confidence() const { return pitchConfidence; }
+
+private:
+  void destroy();
+
+  int sampleRate = 0;
+  int window = 0;
+  int minLag = 0;
+  int maxLag = 0;
+  int fftSize = 0;
+  fftwf_plan forward = nullptr; // both inputs in one batched plan
+  fftwf_plan inverse = nullptr;
+  float *input = nullptr; // first W samples zero-padded, then the frame
+  fftwf_complex *spectra = nullptr;
+  float *correlation = nullptr;
+  std::vector<float> cmnd; // cumulative mean normalised difference
+
+  float f0 = 0.0f;
+  float pitchConfidence = 0.0f;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Single-producer ring of raw float samples. The producer (the audio
+// callback) never waits: it copies whole blocks with at most two memcpys per
+// channel and publishes them by bumping the write head. Channels are stored
+// de-interleaved, one plane each, behind a single head. Any number of
+// consumers follow the stream through their own Cursor and detect when they
+// have been lapped.
+class SampleRing {
+public:
+  static constexpr size_t CACHE_LINE = 64;
+
+  explicit SampleRing(size_t minCapacity, int maxChannels = 1)
+      : maxChannels_(maxChannels) {
+    capacity_ = 1;
+    while (capacity_ < minCapacity)
+      capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    data_ = std::make_unique<float[]>(capacity_ * maxChannels_);
+  }
+
+  SampleRing(const SampleRing &) = delete;
+  SampleRing &operator=(const SampleRing &) = delete;
+
+  size_t capacity() const { return capacity_; }
+  int max_channels() const { return maxChannels_; }
+
+  // Total number of samples ever written.
+  uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+  // Producer only. Wait-free; overwrites the oldest samples when full.
+  void write(const float *src, size_t count) {
+    uint64_t h = head_.load(std::memory_order_relaxed);
+    if (count > capacity_) {
+      src += count - capacity_;
+      h += count - capacity_;
+      count = capacity_;
+    }
+    reserve(h + count);
+    size_t start = h & mask_;
+    size_t first = std::min(count, capacity_ - start);
+    std::memcpy(&data_[start], src, first * sizeof(float));
+    std::memcpy(&data_[0], src + first, (count - first) * sizeof(float));
+    head_.store(h + count, std::memory_order_release);
+    wake();
+  }
+
+  // Producer only. Splits `frames` interleaved frames of `channels` samples
+  // into the channel planes; channels beyond max_channels() are dropped.
+  void write_interleaved(const float *src, size_t frames, int channels) {
+    if (channels == 1) {
+      write(src, frames);
+      return;
+    }
+    uint64_t h = head_.load(std::memory_order_relaxed);
+    if (frames > capacity_) {
+      src += (frames - capacity_) * channels;
+      h += frames - capacity_;
+      frames = capacity_;
+    }
+    reserve(h + frames);
+    size_t start = h & mask_;
+    size_t first = std::min(frames, capacity_ - start);
+    int stored = std::min(channels, maxChannels_);
+    for (int c = 0; c < stored; ++c) {
+      float *plane = &data_[c * capacity_];
+      const float *in = src + c;
+      for (size_t i = 0; i < first; ++i)
+        plane[start + i] = in[i * channels];
+      for (size_t i = first; i < frames; ++i)
+        plane[i - first] = in[i * channels];
+    }
+    head_.store(h + frames, std::memory_order_release);
+    wake();
+  }
+
+  // Blocks the calling consumer until the head moves past `position`,
+  // wake() is called or `running` is clear. The signal is read before the
+  // flag, so a stopper that clears the flag and then calls wake() can never
+  // slip between the check and the wait.
+  void wait(uint64_t position, const std::atomic<bool> &running) const {
+    uint32_t s = signal_.load(std::memory_order_acquire);
+    if (head() > position || !running.load(std::memory_order_acquire))
+      return;
+    signal_.wait(s, std::memory_order_acquire);
+  }
+
+  // Wakes all consumers blocked in wait(), e.g. on shutdown.
+  void wake() {
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_all();
+  }
+
+  // Copies `count` samples of one channel starting at absolute `position`.
+  // Returns false if the producer overwrote any of them before or during
+  // the copy.
+  bool copy(uint64_t position, float *dst, size_t count,
+            int channel = 0) const {
+    uint64_t h = head_.load(std::memory_order_acquire);
+    if (position + count > h || h - position > capacity_)
+      return false;
+    const float *plane = &data_[channel * capacity_];
+    size_t start = position & mask_;
+    size_t first = std::min(count, capacity_ - start);
+    std::memcpy(dst, &plane[start], first * sizeof(float));
+    std::memcpy(dst + first, &plane[0], (count - first) * sizeof(float));
+    // A block still being written counts as written: its slots may
+    // already hold new samples.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return reserved_.load(std::memory_order_relaxed) - position <= capacity_;
+  }
+
+  // Read position of one consumer. Each consumer owns its cursor, so the
+  // position lives on its own cache line away from the producer's head.
+  class alignas(CACHE_LINE) Cursor {
+  public:
+    Cursor() = default;
+    explicit Cursor(const SampleRing &ring)
+        : ring_(&ring), position_(ring.head()) {}
+
+    uint64_t position() const { return position_; }
+    size_t available() const { return size_t(ring_->head() - position_); }
+
+    // Copies the next `count` samples of `channel` without consuming them.
+    bool peek(float *dst, size_t count, int channel = 0) const {
+      return ring_->copy(position_, dst, count, channel);
+    }
+
+    // Copies and consumes the next `count` samples of a mono stream.
+    bool read(float *dst, size_t count) {
+      if (!ring_->copy(position_, dst, count))
+        return false;
+      position_ += count;
+      return true;
+    }
+
+    void skip(size_t count) { position_ += count; }
+
+    // Moves the cursor so that exactly `keep` unread samples remain.
+    // Returns how many samples were skipped.
+    uint64_t catch_up(size_t keep) {
+      uint64_t h = ring_->head();
+      if (h - position_ <= keep)
+        return 0;
+      uint64_t skipped = h - keep - position_;
+      position_ = h - keep;
+      return skipped;
+    }
+
+    // Copies the newest `count` samples, e.g. for oscilloscope views.
+    bool latest(float *dst, size_t count, int channel = 0) const {
+      uint64_t h = ring_->head();
+      if (h < count)
+        return false;
+      return ring_->copy(h - count, dst, count, channel);
+    }
+
+    void wait(const std::atomic<bool> &running) const {
+      ring_->wait(position_, running);
+    }
+
+  private:
+    const SampleRing *ring_ = nullptr;
+    uint64_t position_ = 0;
+  };
+
+  Cursor cursor() const { return Cursor(*this); }
+
+private:
+  // Announces that samples up to `end` are about to be overwritten, before
+  // any slot is touched, so copy() can tell a read overlapped the write.
+  void reserve(uint64_t end) {
+    reserved_.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  alignas(CACHE_LINE) std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> reserved_{0}; // head once the current write lands
+  std::atomic<uint32_t> signal_{0};
+  alignas(CACHE_LINE) std::unique_ptr<float[]> data_;
+  size_t capacity_ = 0;
+  size_t mask_ = 0;
+  int maxChannels_ = 1;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SLIDING_DFT_H
+#define SLIDING_DFT_H
+
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Tracks a few arbitrary frequencies sample by sample with sliding DFTs,
+// at O(1) per frequency per sample instead of a whole FFT per hop. Each
+// frequency has its own window of about CYCLES periods (so low tones get
+// the resolution they need and high ones react fast) and is Hann-windowed
+// in the frequency domain from three resonators: the tone and one window
+// bin either side. Unlike a block Goertzel the result is valid after
+// every sample, and the phase is that of the newest one.
+//
+// The resonators are damped by a hair so rounding errors decay instead of
+// accumulating forever; the effect on the window shape is below 1e-3.
+class SlidingDftBank {
+public:
+  static constexpr int MAX_TONES = 16;
+
+  // Allocates the sample history for windows up to `maxWindowSeconds` and
+  // clears all tones. Not real-time safe.
+  void configure(int sampleRate, float maxWindowSeconds = 0.1f);
+
+  // Replaces the tracked frequencies (Hz, at most MAX_TONES; the rest are
+  // ignored) and restarts them from silence. Real-time safe, so the
+  // thread that calls process() can apply new requests between blocks.
+  void set_frequencies(std::span<const float> hz);
+
+  // Advances every tone by a block of mono samples. Real-time safe.
+  void process(const float *mono, size_t n);
+
+  int tones() const { return numTones; }
+  float frequency(int tone) const { return frequencies[tone]; }
+  // Amplitude of the tone over its window; a full-scale sinusoid at the
+  // tracked frequency reads about 1.
+  float magnitude(int tone) const;
+  // Phase in radians of the tone's cosine at the newest sample.
+  float phase(int tone) const;
+  // Window length in seconds, which is also how long a change takes to
+  // show fully.
+  float window_seconds(int tone) const {
+    return float(windows[tone]) / sampleRate;
+  }
+
+private:
+  static constexpr int CYCLES = 8;
+
+  std::complex<double> windowed(int tone) const;
+
+  int sampleRate = 0;
+  int numTones = 0;
+  int longestWindow = 0;
+  std::vector<float> history; // power-of-two ring of past mono samples
+  size_t historyMask = 0;
+  size_t position = 0;
+
+  float frequencies[MAX_TONES] = {};
+  int windows[MAX_TONES] = {};
+  // Three resonators per tone (centre, one bin up, one bin down): their
+  // sums, per-sample rotations and the factor for the sample leaving the
+  // window.
+  std::complex<double> sums[MAX_TONES][3] = {};
+  std::complex<double> rotations[MAX_TONES][3] = {};
+  std::complex<double> leaving[MAX_TONES] = {};
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SPECTRAL_FEATURES_H
+#define SPECTRAL_FEATURES_H
+
+#include <span>
+#include <vector>
+
+// The bass band ends at a 32nd of the sample rate and the mid band at an
+// eighth, about 1.4 and 5.5 kHz at 44.1 kHz, whatever the FFT size. The
+// time-domain band filterbank splits at the same frequencies.
+constexpr int BASS_TOP_DIVISOR = 32;
+constexpr int MID_TOP_DIVISOR = 8;
+
+// Scalar descriptors of one analysis frame. Spectral values are in the
+// units of SpectrumFrame::magnitudes, except the band levels; time-domain
+// ones are taken from the unwindowed downmix of the same frame.
+struct SpectralFeatures {
+  float rms = 0.0f;
+  float peak = 0.0f;
+  float zero_crossing_rate = 0.0f; // sign changes per sample
+  float mean = 0.0f;               // mean magnitude over all bins
+  float centroid_hz = 0.0f;        // magnitude-weighted mean frequency
+  float rolloff_hz = 0.0f; // 85% of the summed magnitude lies below it
+  // Geometric over arithmetic mean of the power spectrum: near 0 for pure
+  // tones, 1 for white noise
+  float flatness = 0.0f;
+  // Mean rise in magnitude per bin since the previous frame, counting
+  // increases only
+  float flux = 0.0f;
+  // Amplitude of the bass, mid and treble bands from their power: a
+  // full-scale sinusoid in a band reads about 1 for any window and FFT
+  // size, as the filterbank envelopes do
+  float bass = 0.0f;
+  float mid = 0.0f;
+  float treble = 0.0f;
+};
+
+// Computes SpectralFeatures from one pass over the spectrum and one over
+// the samples (spectral_sums() and signal_sums()), so visualizers never
+// have to walk the bins themselves. Rolloff comes from the pass's partial
+// sums, the band levels from one signal_sums() pass over each band.
+class SpectralFeatureExtractor {
+public:
+  // Resets the previous frame used for the flux.
+  void configure(int bins, int sampleRate, int fftSize);
+  // Sets the analysis window the band levels are normalised for.
+  void set_window(std::span<const float> window);
+
+  // `magnitudes` must hold bins() values.
+  void process(std::span<const float> magnitudes,
+               std::span<const float> samples, SpectralFeatures &out);
+
+  int bins() const { return int(previous.size()); }
+
+  // Bass level of any spectrum of the configured size, e.g. a part of the
+  // one given to process(), in the units of SpectralFeatures::bass.
+  float bass_level(std::span<const float> magnitudes) const {
+    return band_level(magnitudes.data(), 0, bassEnd);
+  }
+
+private:
+  float band_level(const float *magnitudes, int begin, int end) const;
+  float rolloff_bin(const float *magnitudes, float total) const;
+
+  float binHz = 0.0f;
+  int bassEnd = 1, midEnd = 2;
+  // Turns a band's summed power into the squared amplitude of a sinusoid
+  float amplitudeScale = 0.0f;
+  std::vector<float> previous;
+  std::vector<float> chunks;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SPECTRUM_PROCESSOR_H
+#define SPECTRUM_PROCESSOR_H
+
+#include <span>
+#include <vector>
+
+// Turns the latest magnitude spectrum into the per-bar levels the shaders
+// draw: band averages over power-law spaced frequency ranges, one gain for
+// all bars that follows the loudness meter, power-law compression and
+// exponential smoothing. Runs once per rendered frame; every visualizer
+// reads the same output, and the warmed-up state survives mode switches.
+// Each quantity is its own array, so every step is one straight loop over
+// all bars.
+class SpectrumProcessor {
+public:
+  explicit SpectrumProcessor(int bars);
+
+  // Bars come from the log-spaced bands in `logBands` (constant-Q or
+  // multi-resolution), spread evenly, when it is not empty, and otherwise
+  // from the FFT magnitudes along a power curve. The gain follows
+  // `programmeLufs` (gated loudness of the current track), calibrated
+  // against `momentaryLufs`; both at or below -70 LUFS hold it.
+  void process(std::span<const float> spectrum,
+               std::span<const float> logBands, float momentaryLufs,
+               float programmeLufs, float dt);
+
+  std::span<const float> bars() const { return smoothed; }
+  // bars() with every value padded to a vec4: the std140 layout of the
+  // shaders' u_fft[] uniform block.
+  std::span<const float> std140() const { return padded; }
+
+private:
+  void buildBarEdges(int bins, bool logSpaced);
+
+  int numBars;
+  int barBins = 0;
+  bool barsLogSpaced = false;
+  // Bar i covers [edge i, edge i + 1) in fractional bin units, stored as
+  // integer bin plus fraction. invWidth holds 1 / (edge i+1 - edge i).
+  std::vector<int> edgeBin;
+  std::vector<float> edgeFrac, invWidth;
+  // Integral of the linearly interpolated spectrum up to each edge
+  std::vector<double> edgeIntegral;
+  std::vector<float> level, equalised, smoothed, padded;
+  float calibration = 0.0f; // mean bar level per unit of momentary loudness
+  float gain = 0.0f;
+};
+
+#endif
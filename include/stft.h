@@ -0,0 +1,43 @@
+#ifndef STFT_H
+#define STFT_H
+
+#include "sample_ring.h"
+#include <vector>
+
+enum class WindowType { Rectangular, Hann, BlackmanHarris, Kaiser };
+
+// Periodic window of `size` points, scaled to unit mean so that windowed
+// magnitudes stay comparable to the unwindowed ones.
+std::vector<float> make_window(WindowType type, int size,
+                               float kaiserBeta = 8.6f);
+
+// Cuts overlapping, windowed frames out of a sample stream. The update rate
+// is sampleRate / hopSize and is independent of the FFT size.
+class Stft {
+public:
+  void configure(int fftSize, int hopSize, WindowType type,
+                 float kaiserBeta = 8.6f);
+
+  // Windows the next frame of each of the first `channels` channels from
+  // `cursor` into `out` (channels * fftSize floats, one frame after the
+  // other) and advances the cursor by one hop. If `mono` is not null it
+  // also receives the unwindowed frame averaged over the channels. Returns
+  // false if no complete frame is buffered yet or it was overwritten while
+  // reading.
+  bool next_frame(SampleRing::Cursor &cursor, float *out, int channels = 1,
+                  float *mono = nullptr);
+
+  int fft_size() const { return fftSize; }
+  int hop_size() const { return hopSize; }
+  WindowType window_type() const { return windowType; }
+  const std::vector<float> &window_values() const { return window; }
+
+private:
+  int fftSize = 0;
+  int hopSize = 0;
+  WindowType windowType = WindowType::Hann;
+  std::vector<float> window;
+  std::vector<float> frame;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of the latest value from one writer thread to one
+// reader thread. The writer fills back(), then publish() swaps it with the
+// shared middle slot; the reader's update() swaps the middle slot with its
+// front buffer when something new is there. Neither side ever waits or
+// allocates, and the reader always sees a complete value.
+template <typename T> class TripleBuffer {
+public:
+  // Writer side.
+  T &back() { return buffers_[back_]; }
+  void publish() {
+    uint8_t prev = middle_.exchange(back_ | DIRTY, std::memory_order_acq_rel);
+    back_ = prev & INDEX;
+  }
+
+  // Reader side. Returns true if a newer value became the front buffer.
+  bool update() {
+    if (!(middle_.load(std::memory_order_relaxed) & DIRTY))
+      return false;
+    uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = prev & INDEX;
+    return true;
+  }
+  const T &front() const { return buffers_[front_]; }
+
+  // Not thread-safe; only for setup while neither side is running.
+  T &slot(int i) { return buffers_[i]; }
+
+private:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t DIRTY = 0x4;
+
+  T buffers_[3];
+  alignas(64) uint8_t back_ = 0;
+  alignas(64) std::atomic<uint8_t> middle_{1};
+  alignas(64) uint8_t front_ = 2;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef WAV_READER_H
+#define WAV_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+
+// Streaming reader for RIFF/WAVE files with 16/24/32-bit integer PCM or
+// 32-bit float samples. The file is memory-mapped rather than read through
+// stdio or iostreams: the kernel is told access is sequential, the next few
+// megabytes are prefetched ahead of the read position and pages behind it
+// are released, so hours-long recordings stream with a small, constant
+// resident set. Samples are converted to float with the SIMD kernels.
+class WavReader {
+public:
+  WavReader() = default;
+  ~WavReader();
+  WavReader(const WavReader &) = delete;
+  WavReader &operator=(const WavReader &) = delete;
+
+  std::expected<void, std::string> open(const std::string &path);
+  void close();
+
+  int sample_rate() const { return sampleRate; }
+  int channels() const { return numChannels; }
+  uint64_t frames() const { return totalFrames; }
+  uint64_t position() const { return framePos; }
+
+  // Decodes up to `frames` interleaved frames to float in [-1, 1]. Returns
+  // the number of frames read; 0 at the end of the data.
+  size_t read(float *out, size_t frames);
+
+  void seek(uint64_t frame);
+
+private:
+  void advise(size_t offset);
+
+  const unsigned char *map = nullptr;
+  size_t mapSize = 0;
+  const unsigned char *data = nullptr; // start of the sample data
+  int sampleRate = 0;
+  int numChannels = 0;
+  int bytesPerSample = 0;
+  bool isFloat = false;
+  uint64_t totalFrames = 0;
+  uint64_t framePos = 0;
+  size_t prefetchedTo = 0; // byte offset into the mapping
+  size_t releasedTo = 0;
+};
+
+#endif
@@ -1,9 +1,26 @@
 #include "audio.h"
+#include "audio_source.h"
+#include "beat_tracker.h"
+#include "biquad_filterbank.h"
+#include "chroma.h"
+#include "constant_q.h"
+#include "dsp_kernels.h"
+#include "event_queue.h"
+#include "fft_plans.h"
+#include "hpss.h"
+#include "loudness_meter.h"
+#include "mel.h"
+#include "multi_resolution.h"
+#include "onset_detector.h"
+#include "pitch_tracker.h"
+#include "sliding_dft.h"
+#include "spectral_features.h"
 #include "filemanager.h"
 #include "stb_image.h"
 #include <GL/gl.h>
-#include <GLFW/glfw3.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <expected>
 #include <fftw3.h>
@@ -11,10 +28,14 @@
 #include <iostream>
 #include <iterator>
 #include <mutex>
+#include <optional>
 #include <ostream>
-#include <portaudio.h>
+#include <thread>
 #include <vector>
+#include "sample_ring.h"
+#include "stft.h"
 #include "tinyfiledialogs.h"
+#include "triple_buffer.h"
 
 std::expected<GLuint, std::string> loadTexture(const char *path) {
   GLuint textureID;
@@ -62,63 +83,904 @@ void AudioPlayer::loadSelectedTexture() {
   }
 }
 
-constexpr int FFT_SIZE = 1024;
+constexpr size_t CAPTURE_RING_SIZE = 1 << 17;
+constexpr int MAX_CHANNELS = 8;
+// Below this tempo confidence the shaders get no beat pulse
+constexpr float MIN_BEAT_CONFIDENCE = 0.1f;
+
+// Analysis thread -> render thread hand-off of finished spectra
+static TripleBuffer<SpectrumFrame> spectrum_frames;
+static uint64_t spectrum_sequence = 0;
+
+// Analysis thread -> render thread stream of detected onsets
+static EventQueue<OnsetEvent, 256> onset_events;
+
+// FFT state, owned by the analysis thread while it runs
+static fftwf_plan fft_plan = nullptr;
+static float *fft_input = nullptr;
+static fftwf_complex *fft_output = nullptr;
+static std::unique_ptr<MultiResolutionAnalyser> multi_resolution;
+
+// Raw capture stream. The audio callback is the only writer; the analysis
+// thread and any waveform views read it through their own cursors.
+static SampleRing capture_ring(CAPTURE_RING_SIZE, MAX_CHANNELS);
+static int capture_channels = 1;
+
+static std::thread analysis_thread;
+static std::atomic<bool> analysis_running{false};
+static std::unique_ptr<AudioSource> source;
+
+// Configuration of the running pipeline and pending runtime changes. The
+// rebuild happens on config_thread so the render loop keeps drawing the
+// last published spectrum meanwhile.
+static std::mutex config_mutex;
+static AudioConfig active_config;
+static std::optional<AudioConfig> pending_config;
+static std::thread config_thread;
+static std::atomic<bool> reconfiguring{false};
+// Set when neither a requested configuration nor its fallback would open,
+// so no audio is flowing; cleared by the next pipeline that opens.
+static std::atomic<bool> audio_stopped{false};
+
+// Audio clock reached by the analysis thread, carried across rebuilds so
+// timestamps stay monotonic when the sample rate changes.
+static double analysed_until = 0.0;
+
+// Callback timing, written by the audio thread only
+static std::atomic<float> callback_last_us{0.0f};
+static std::atomic<float> callback_max_us{0.0f};
+static std::atomic<uint64_t> callback_count{0};
+static std::atomic<uint64_t> dropped_blocks{0};
+
+// Arrival time of the newest captured sample: the ring head and a steady
+// clock reading in microseconds, each truncated to 32 bits and packed into
+// one word so they are always read as a pair. Only ever used in modular
+// differences, so the wrap-around is harmless.
+static std::atomic<uint64_t> capture_clock{0};
+
+static uint32_t steady_micros() {
+  return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count());
+}
+
+static double steady_seconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Steady-clock seconds at which the sample at ring `position` reached
+// capture_block: when the newest block arrived, minus the time the samples
+// after it span. Assumes a source delivering in real time.
+static double arrival_seconds(uint64_t position, int sampleRate) {
+  uint64_t clock = capture_clock.load(std::memory_order_acquire);
+  uint32_t head = uint32_t(clock >> 32);
+  uint32_t arrivedUs = uint32_t(clock);
+  double now = steady_seconds();
+  uint32_t sinceArrivalUs = steady_micros() - arrivedUs;
+  return now - sinceArrivalUs * 1e-6 -
+         double(uint32_t(head - uint32_t(position))) / sampleRate;
+}
+
+// FFT planning cost of the last pipeline rebuild
+static std::atomic<float> plan_ms{0.0f};
+static std::atomic<bool> wisdom_loaded{false};
+
+// Ring position the analysis thread has consumed up to, and whether the
+// source runs faster than real time and must wait for it.
+static std::atomic<uint64_t> analysed_position{0};
+static std::atomic<bool> capture_throttled{false};
+
+// Bass/mid/treble envelopes straight from the capture blocks, a callback
+// period behind the audio rather than half an FFT. The filterbank belongs
+// to whichever thread delivers blocks; the envelopes are read by render().
+static BiquadFilterbank band_filterbank;
+static std::atomic<bool> filterbank_enabled{false};
+static std::atomic<float> band_envelopes[3];
+
+// Loudness of every capture block, owned like the filterbank; the readings
+// drive the bars' auto-gain in render().
+static LoudnessMeter loudness_meter;
+static std::atomic<float> loudness_readings[4];
+
+// Frequencies tracked sample by sample, also owned by the thread that
+// delivers blocks. The UI hands it new frequency lists through
+// tone_requests; each block's result goes out through tone_frames, the
+// same way spectra do.
+struct ToneRequest {
+  float hz[SlidingDftBank::MAX_TONES] = {};
+  int count = 0;
+};
+struct ToneFrame {
+  double timestamp = 0.0;
+  double captured_at = 0.0;
+  TrackedTone tones[SlidingDftBank::MAX_TONES] = {};
+  int count = 0;
+};
+static SlidingDftBank tone_bank;
+static TripleBuffer<ToneRequest> tone_requests;
+static TripleBuffer<ToneFrame> tone_frames;
+static int tone_sample_rate = 0;
+static bool tone_realtime = false;
+// Audio clock of the bank, matching the analyser's for the same pipeline
+static uint64_t tone_clock_origin = 0;
+static double tone_clock_start = 0.0;
+
+// Called with the source stopped whenever a pipeline is opened.
+static void configure_block_trackers(const AudioConfig &config) {
+  // Split where SpectralFeatures does, so both paths give the same bands
+  band_filterbank.configure(
+      config.sample_rate, {float(config.sample_rate) / BASS_TOP_DIVISOR,
+                           float(config.sample_rate) / MID_TOP_DIVISOR});
+  loudness_meter.configure(config.sample_rate, config.channels);
+  for (auto &reading : loudness_readings)
+    reading.store(LoudnessMeter::SILENT, std::memory_order_relaxed);
+  tone_bank.configure(config.sample_rate);
+  tone_requests.update();
+  const ToneRequest &request = tone_requests.front();
+  tone_bank.set_frequencies({request.hz, size_t(request.count)});
+  tone_sample_rate = config.sample_rate;
+  tone_realtime = config.realtime;
+  tone_clock_origin = capture_ring.head();
+  tone_clock_start = analysed_until;
+}
+
+static void publish_tones() {
+  ToneFrame &frame = tone_frames.back();
+  const uint64_t head = capture_ring.head();
+  frame.timestamp = tone_clock_start +
+                    double(head - tone_clock_origin) / tone_sample_rate;
+  frame.captured_at =
+      tone_realtime ? arrival_seconds(head, tone_sample_rate) : 0.0;
+  frame.count = tone_bank.tones();
+  for (int t = 0; t < frame.count; ++t)
+    frame.tones[t] = {tone_bank.frequency(t), tone_bank.magnitude(t),
+                      tone_bank.phase(t)};
+  tone_frames.publish();
+}
+
+// Meters the loudness of one block and runs the filterbank and the tone
+// bank, whichever are in use, over its downmix. Real-time safe.
+static void track_block(const float *interleaved, size_t frames,
+                        int channels) {
+  loudness_meter.process(interleaved, frames);
+  loudness_readings[0].store(loudness_meter.momentary(),
+                             std::memory_order_relaxed);
+  loudness_readings[1].store(loudness_meter.short_term(),
+                             std::memory_order_relaxed);
+  loudness_readings[2].store(loudness_meter.integrated(),
+                             std::memory_order_relaxed);
+  loudness_readings[3].store(loudness_meter.programme(),
+                             std::memory_order_relaxed);
+  if (tone_requests.update()) {
+    const ToneRequest &request = tone_requests.front();
+    tone_bank.set_frequencies({request.hz, size_t(request.count)});
+    publish_tones(); // the reader sees the new list, even an empty one
+  }
+  const bool filterbank = filterbank_enabled.load(std::memory_order_relaxed);
+  const bool tones = tone_bank.tones() > 0;
+  if (!filterbank && !tones)
+    return;
+  auto process = [&](const float *mono, size_t n) {
+    if (filterbank)
+      band_filterbank.process(mono, n);
+    if (tones)
+      tone_bank.process(mono, n);
+  };
+  if (channels == 1) {
+    process(interleaved, frames);
+  } else {
+    float mono[512];
+    const float scale = 1.0f / channels;
+    for (size_t done = 0; done < frames;) {
+      size_t n = std::min(frames - done, std::size(mono));
+      const float *in = interleaved + done * channels;
+      for (size_t i = 0; i < n; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; ++c)
+          sum += in[i * channels + c];
+        mono[i] = sum * scale;
+      }
+      process(mono, n);
+      done += n;
+    }
+  }
+  if (filterbank)
+    for (int b = 0; b < 3; ++b)
+      band_envelopes[b].store(band_filterbank.envelope(b),
+                              std::memory_order_relaxed);
+  if (tones)
+    publish_tones();
+}
+
+// Sink for every audio source, called on its real-time delivery thread.
+static void capture_block(const float *interleaved, unsigned long frames,
+                          void *) {
+  // Unpaced file playback: hold the producer back while the analysis is
+  // more than half a ring behind so no sample is ever overwritten unread.
+  // Never taken for device sources, whose callbacks must not block.
+  if (capture_throttled.load(std::memory_order_relaxed)) {
+    while (analysis_running.load(std::memory_order_relaxed) &&
+           capture_ring.head() + frames -
+                   analysed_position.load(std::memory_order_acquire) >
+               capture_ring.capacity() / 2)
+      std::this_thread::yield();
+  }
 
-static std::vector<float> fft_magnitudes(FFT_SIZE / 2);
-static std::mutex fft_mutex;
+  auto t0 = std::chrono::steady_clock::now();
+
+  capture_ring.write_interleaved(interleaved, frames, capture_channels);
+  capture_clock.store(uint64_t(uint32_t(capture_ring.head())) << 32 |
+                          steady_micros(),
+                      std::memory_order_release);
+  track_block(interleaved, frames, capture_channels);
+
+  float us = std::chrono::duration<float, std::micro>(
+                 std::chrono::steady_clock::now() - t0)
+                 .count();
+  callback_last_us.store(us, std::memory_order_relaxed);
+  if (us > callback_max_us.load(std::memory_order_relaxed))
+    callback_max_us.store(us, std::memory_order_relaxed);
+  callback_count.fetch_add(1, std::memory_order_relaxed);
+}
 
-// FFT state
-static fftwf_plan fft_plan;
-static float input_buffer[FFT_SIZE];
-static fftwf_complex output_buffer[FFT_SIZE];
-static int buffer_index = 0;
+// Requested STFT settings, written by the UI and picked up by the analysis
+// thread before its next frame.
+static std::atomic<WindowType> requested_window{WindowType::Hann};
+static std::atomic<int> requested_hop{256};
+static std::atomic<int> requested_cq_bins{0};
+static std::atomic<int> requested_mel_bands{0};
+static std::atomic<int> requested_mfccs{0};
+
+// Constant-Q cost, written by the analysis thread
+static std::atomic<float> cq_us{0.0f};
+static std::atomic<float> mel_us{0.0f};
+static std::atomic<float> features_us{0.0f};
+static std::atomic<float> pitch_us{0.0f};
+static std::atomic<float> hpss_us{0.0f};
+static std::atomic<size_t> cq_nonzeros{0};
+
+// Onset detection latency, from the onset's sample reaching capture_block
+// to its event being queued. Live sources only.
+static std::atomic<float> onset_latency_ms{0.0f};
+static std::atomic<float> onset_latency_max_ms{0.0f};
+static std::atomic<uint64_t> onset_count{0};
+
+// Tempo and beat prediction from the onset stream. Owned by the analysis
+// thread while it runs; its FFT plans are made with the others, and its
+// state survives pipeline rebuilds since the audio clock does.
+static BeatTracker beat_tracker;
+static std::atomic<float> tempo_bpm{0.0f};
+static std::atomic<float> tempo_confidence{0.0f};
+
+// Pitch of the downmix, read straight from the capture ring at the end of
+// every analysed frame. Planned with the other FFTs, used by the analysis
+// thread.
+static PitchTracker pitch_tracker;
+
+// Cuts overlapping windowed frames from the capture ring and runs the FFT,
+// all channels in one batched plan. Lives on the analysis thread, or on the
+// caller of feed_audio() when rendering offline.
+class Analyser {
+public:
+  explicit Analyser(const AudioConfig &config)
+      : config(config), clockOrigin(capture_ring.head()),
+        clockStart(analysed_until), cursor(capture_ring.cursor()),
+        samples(config.fft_size) {
+    features.configure(config.fft_size / 2, config.sample_rate,
+                       config.fft_size);
+    hpss.configure(config.fft_size / 2);
+    if (config.channels > 1) {
+      mix.resize(config.fft_size);
+      diff.resize(config.fft_size);
+    }
+  }
 
-static int audio_callback(const void *inputBuffer, void *, unsigned long frames,
-                          const PaStreamCallbackTimeInfo *,
-                          PaStreamCallbackFlags, void *) {
-  const float *in = static_cast<const float *>(inputBuffer);
+  // Analyses and publishes the next frame. Returns false if the ring does
+  // not hold a complete one yet. When live, falling several hops behind
+  // skips ahead to the newest complete frame and counts the rest as
+  // dropped.
+  bool step() {
+    const int fftSize = config.fft_size;
+    WindowType window = requested_window.load(std::memory_order_relaxed);
+    int hop = std::clamp(requested_hop.load(std::memory_order_relaxed), 1,
+                         fftSize);
+    int cqBins = requested_cq_bins.load(std::memory_order_relaxed);
+    bool windowChanged =
+        window != stft.window_type() || stft.fft_size() != fftSize;
+    if (windowChanged || hop != stft.hop_size())
+      stft.configure(fftSize, hop, window);
+    if (windowChanged)
+      features.set_window(stft.window_values());
+    if (windowChanged || cqBins != constantQ.bins_per_octave()) {
+      constantQ.configure(fftSize, config.sample_rate, cqBins,
+                          stft.window_values(), CQ_MIN_FREQ);
+      cq_nonzeros.store(constantQ.nonzeros(), std::memory_order_relaxed);
+    }
+    int melBands = requested_mel_bands.load(std::memory_order_relaxed);
+    int mfccs = std::min(melBands,
+                         requested_mfccs.load(std::memory_order_relaxed));
+    if (fftSize != melFftSize || melBands != mel.bands() ||
+        mfccs != mel.coefficients()) {
+      mel.configure(fftSize, config.sample_rate, melBands, mfccs);
+      melFftSize = fftSize;
+    }
+
+    const int bins = fftSize / 2;
+    const float hopSeconds = float(hop) / config.sample_rate;
+    if (windowChanged || onsets.bins() != bins ||
+        onsets.hop_seconds() != hopSeconds) {
+      // Full-scale sinusoids read as amplitude 1
+      double windowSum = 0.0;
+      for (float w : stft.window_values())
+        windowSum += w;
+      onsets.configure(bins, hopSeconds, float(2.0 / windowSum));
+    }
+
+    if (cursor.available() < size_t(fftSize))
+      return false;
+    if (!config.realtime) {
+      // Backpressure in capture_block keeps the ring from lapping us.
+    } else if (cursor.available() > size_t(fftSize + 4 * hop)) {
+      uint64_t skipped = cursor.catch_up(fftSize);
+      dropped_blocks.fetch_add((skipped + hop - 1) / hop,
+                               std::memory_order_relaxed);
+    }
+    uint64_t frameEnd = cursor.position() + fftSize;
+    if (!stft.next_frame(cursor, fft_input, config.channels,
+                         samples.data())) {
+      dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+      cursor.catch_up(fftSize);
+      return true;
+    }
+
+    fftwf_execute(fft_plan);
+    publish(frameEnd);
+    return true;
+  }
 
-  for (unsigned long i = 0; i < frames; ++i) {
-    input_buffer[buffer_index++] = in[i];
+  void wait(const std::atomic<bool> &running) const { cursor.wait(running); }
+
+private:
+  void publish(uint64_t frameEnd) {
+    const int bins = config.fft_size / 2;
+    const int channels = config.channels;
+    const int stride = config.fft_size / 2 + 1;
+
+    SpectrumFrame &frame = spectrum_frames.back();
+    frame.channels = channels;
+    frame.magnitudes.resize(bins);
+    const float *spectra = &fft_output[0][0];
+    if (channels == 1) {
+      frame.channel_magnitudes.clear();
+      frame.mid.clear();
+      frame.side.clear();
+      complex_magnitude(spectra, frame.magnitudes.data(), bins);
+      transform_cq(frame, spectra, 1.0f);
+      transform_mel(frame, spectra, 1.0f);
+    } else {
+      // The transform is linear, so downmix and mid/side spectra come from
+      // sums of the channel spectra without extra FFTs.
+      frame.channel_magnitudes.resize(channels * bins);
+      frame.mid.resize(bins);
+      frame.side.resize(bins);
+      for (int c = 0; c < channels; ++c)
+        complex_magnitude(spectra + 2 * c * stride,
+                          &frame.channel_magnitudes[c * bins], bins);
+
+      const float *l = spectra;
+      const float *r = spectra + 2 * stride;
+      std::copy(l, l + 2 * bins, mix.begin());
+      for (int c = 1; c < channels; ++c) {
+        const float *x = spectra + 2 * c * stride;
+        for (int i = 0; i < 2 * bins; ++i)
+          mix[i] += x[i];
+      }
+      complex_magnitude(mix.data(), frame.magnitudes.data(), bins,
+                        1.0f / channels);
+      transform_cq(frame, mix.data(), 1.0f / channels);
+      transform_mel(frame, mix.data(), 1.0f / (channels * channels));
+
+      for (int i = 0; i < 2 * bins; ++i) {
+        mix[i] = l[i] + r[i];
+        diff[i] = l[i] - r[i];
+      }
+      complex_magnitude(mix.data(), frame.mid.data(), bins, 0.5f);
+      complex_magnitude(diff.data(), frame.side.data(), bins, 0.5f);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    features.process(frame.magnitudes, samples, frame.features);
+    features_us.store(std::chrono::duration<float, std::micro>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count(),
+                      std::memory_order_relaxed);
+    separate(frame);
+    frame.sequence = ++spectrum_sequence;
+    frame.timestamp =
+        clockStart + double(frameEnd - clockOrigin) / config.sample_rate;
+    frame.captured_at =
+        config.realtime ? arrival_seconds(frameEnd, config.sample_rate) : 0.0;
+    analysed_until = frame.timestamp;
+    if (multi_resolution) {
+      // Without threads the resolutions are stepped up to this frame here,
+      // so fast and offline runs see the same alignment every time.
+      if (!config.realtime)
+        multi_resolution->advance_to(frameEnd);
+      multi_resolution->stitch(frame.bands);
+      frame.band_info = multi_resolution->bands();
+    } else {
+      frame.bands.clear();
+      frame.band_info.clear();
+    }
+    track_rhythm(frame, frameEnd);
+    track_pitch(frame, frameEnd);
+    track_harmony(frame);
+    analysed_position.store(cursor.position(), std::memory_order_release);
+    spectrum_frames.publish();
+  }
 
-    if (buffer_index >= FFT_SIZE) {
-      buffer_index = 0;
+  double audio_clock(uint64_t position) const {
+    return clockStart + (double(position) - clockOrigin) / config.sample_rate;
+  }
 
-      fftwf_execute(fft_plan);
+  // Splits the downmix into harmonic and percussive spectra.
+  void separate(SpectrumFrame &frame) {
+    auto t0 = std::chrono::steady_clock::now();
+    frame.harmonic.resize(frame.magnitudes.size());
+    frame.percussive.resize(frame.magnitudes.size());
+    hpss.process(frame.magnitudes, frame.harmonic, frame.percussive);
+    frame.percussive_bass = features.bass_level(frame.percussive);
+    frame.percussive_fraction = hpss.percussive_fraction();
+    hpss_us.store(std::chrono::duration<float, std::micro>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count(),
+                  std::memory_order_relaxed);
+  }
 
-      std::lock_guard<std::mutex> lock(fft_mutex);
-      for (int i = 0; i < FFT_SIZE / 2; ++i) {
-        float re = output_buffer[i][0];
-        float im = output_buffer[i][1];
-        fft_magnitudes[i] = sqrtf(re * re + im * im);
+  // Runs the onset detector on the percussive part of the downmix, so
+  // sustained notes changing do not read as hits, queues any onset,
+  // stamped with the audio clock at the centre of the frame it was found
+  // in, and feeds the beat tracker.
+  void track_rhythm(SpectrumFrame &frame, uint64_t frameEnd) {
+    const uint64_t centre = frameEnd - config.fft_size / 2;
+    std::optional<OnsetDetector::Onset> onset =
+        onsets.process(frame.percussive);
+    beat_tracker.add_frame(audio_clock(centre), onsets.novelty());
+    if (onset) {
+      const uint64_t position =
+          centre - uint64_t(onset->framesAgo) * stft.hop_size();
+      OnsetEvent event;
+      event.timestamp = audio_clock(position);
+      event.strength = onset->strength;
+      onset_events.push(event);
+      onset_count.fetch_add(1, std::memory_order_relaxed);
+      beat_tracker.add_onset(event.timestamp, event.strength);
+
+      if (config.realtime) {
+        float latency = float(
+            (steady_seconds() - arrival_seconds(position, config.sample_rate)) *
+            1e3);
+        onset_latency_ms.store(latency, std::memory_order_relaxed);
+        if (latency > onset_latency_max_ms.load(std::memory_order_relaxed))
+          onset_latency_max_ms.store(latency, std::memory_order_relaxed);
       }
     }
+
+    frame.next_beat = beat_tracker.next_beat();
+    frame.beat_period = beat_tracker.beat_period();
+    frame.tempo_confidence = beat_tracker.confidence();
+    tempo_bpm.store(beat_tracker.bpm(), std::memory_order_relaxed);
+    tempo_confidence.store(beat_tracker.confidence(),
+                           std::memory_order_relaxed);
+  }
+
+  // Runs the pitch tracker on the raw downmix of the samples up to the end
+  // of this frame, which can reach further back than the frame itself.
+  void track_pitch(SpectrumFrame &frame, uint64_t frameEnd) {
+    const size_t length = pitch_tracker.frame_length();
+    frame.pitch_hz = frame.pitch_confidence = 0.0f;
+    if (frameEnd < length)
+      return;
+    auto t0 = std::chrono::steady_clock::now();
+    pitchInput.resize(length);
+    pitchChannel.resize(length);
+    for (int c = 0; c < config.channels; ++c) {
+      float *dst = c == 0 ? pitchInput.data() : pitchChannel.data();
+      if (!capture_ring.copy(frameEnd - length, dst, length, c))
+        return;
+      if (c > 0)
+        for (size_t i = 0; i < length; ++i)
+          pitchInput[i] += pitchChannel[i];
+    }
+    if (config.channels > 1)
+      for (float &v : pitchInput)
+        v *= 1.0f / config.channels;
+    pitch_tracker.process(pitchInput.data());
+    frame.pitch_hz = pitch_tracker.frequency();
+    frame.pitch_confidence = pitch_tracker.confidence();
+    pitch_us.store(std::chrono::duration<float, std::micro>(
+                       std::chrono::steady_clock::now() - t0)
+                       .count(),
+                   std::memory_order_relaxed);
+  }
+
+  // Chroma from the constant-Q bins when they are on, which resolve
+  // semitones all the way down, and from the FFT bins otherwise.
+  void track_harmony(SpectrumFrame &frame) {
+    const bool useCq = !frame.cq.empty();
+    const std::span<const float> input =
+        useCq ? std::span<const float>(frame.cq) : frame.magnitudes;
+    const int bpo = useCq ? frame.cq_bins_per_octave : 0;
+    if (!chroma.maps(int(input.size()), bpo)) {
+      if (useCq)
+        chroma.configure_cq(int(input.size()), bpo);
+      else
+        chroma.configure_fft(int(input.size()), config.sample_rate,
+                             config.fft_size);
+    }
+    chroma.process(input, float(stft.hop_size()) / config.sample_rate,
+                   frame.chroma);
+    frame.key = chroma.key();
+    frame.key_strength = chroma.key_strength();
+  }
+
+  // Constant-Q magnitudes of `spectrum`, multiplied by `scale`.
+  void transform_cq(SpectrumFrame &frame, const float *spectrum,
+                    float scale) {
+    frame.cq_bins_per_octave = constantQ.bins_per_octave();
+    frame.cq_min_freq = CQ_MIN_FREQ;
+    frame.cq.resize(constantQ.bins());
+    if (frame.cq.empty())
+      return;
+    auto t0 = std::chrono::steady_clock::now();
+    constantQ.process(spectrum, frame.cq.data());
+    if (scale != 1.0f)
+      for (float &v : frame.cq)
+        v *= scale;
+    cq_us.store(std::chrono::duration<float, std::micro>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count(),
+                std::memory_order_relaxed);
   }
 
-  return paContinue;
+  // Mel energies and MFCCs of `spectrum`, whose power is multiplied by
+  // `powerScale`.
+  void transform_mel(SpectrumFrame &frame, const float *spectrum,
+                     float powerScale) {
+    frame.mel.resize(mel.bands());
+    frame.mfcc.resize(mel.coefficients());
+    if (frame.mel.empty())
+      return;
+    auto t0 = std::chrono::steady_clock::now();
+    const int bins = config.fft_size / 2;
+    power.resize(bins);
+    complex_power(spectrum, power.data(), bins);
+    if (powerScale != 1.0f)
+      for (float &p : power)
+        p *= powerScale;
+    mel.process(power.data(), frame.mel.data(), frame.mfcc.data());
+    mel_us.store(std::chrono::duration<float, std::micro>(
+                     std::chrono::steady_clock::now() - t0)
+                     .count(),
+                 std::memory_order_relaxed);
+  }
+
+  static constexpr float CQ_MIN_FREQ = 32.703f; // C1
+
+  AudioConfig config;
+  const uint64_t clockOrigin;
+  const double clockStart;
+  SampleRing::Cursor cursor;
+  Stft stft;
+  ConstantQ constantQ;
+  MelFilterbank mel;
+  OnsetDetector onsets;
+  SpectralFeatureExtractor features;
+  HarmonicPercussiveSeparator hpss;
+  Chromagram chroma;
+  int melFftSize = 0;
+  std::vector<float> samples; // unwindowed downmix of the current frame
+  std::vector<float> pitchInput, pitchChannel;
+  std::vector<float> power;
+  // Complex scratch for multichannel downmix and mid/side
+  std::vector<float> mix, diff;
+};
+
+// Set while an offline pipeline is open; see start_offline_audio().
+static std::unique_ptr<Analyser> offline_analyser;
+
+static void analysis_loop(AudioConfig config) {
+  Analyser analyser(config);
+  while (analysis_running.load(std::memory_order_relaxed))
+    if (!analyser.step())
+      analyser.wait(analysis_running);
 }
 
-float get_amplitude() {
-  auto data = get_fft_data();
-  float sum = 0.0f;
-  for (float v : data)
-    sum += v;
-  return sum / data.size(); // average energy
+float get_amplitude() { return acquire_spectrum().features.mean; }
+
+Loudness get_loudness() {
+  return {loudness_readings[0].load(std::memory_order_relaxed),
+          loudness_readings[1].load(std::memory_order_relaxed),
+          loudness_readings[2].load(std::memory_order_relaxed),
+          loudness_readings[3].load(std::memory_order_relaxed)};
 }
-void start_audio() {
-  fft_plan = fftwf_plan_dft_r2c_1d(FFT_SIZE, input_buffer, output_buffer,
-                                   FFTW_MEASURE);
 
-  Pa_Initialize();
-  PaStream *stream;
-  Pa_OpenDefaultStream(&stream, 1, 0, paFloat32, 44100, 256, audio_callback,
-                       nullptr);
-  Pa_StartStream(stream);
+// Tears down the source, the analysis thread and the FFT state, in that
+// order, so nothing is freed while still in use.
+static void close_pipeline() {
+  if (source) {
+    source->close();
+    source.reset();
+  }
+
+  analysis_running = false;
+  capture_ring.wake();
+  if (analysis_thread.joinable())
+    analysis_thread.join();
+  offline_analyser.reset();
+  multi_resolution.reset();
+
+  if (fft_plan)
+    fftwf_destroy_plan(fft_plan);
+  fftwf_free(fft_input);
+  fftwf_free(fft_output);
+  fft_plan = nullptr;
+  fft_input = nullptr;
+  fft_output = nullptr;
+}
+
+// Allocates the transform buffers and plans the batched FFT.
+static void create_fft(const AudioConfig &config) {
+  fft_input = fftwf_alloc_real(config.channels * config.fft_size);
+  fft_output = fftwf_alloc_complex(config.channels * (config.fft_size / 2 + 1));
+
+  auto t0 = std::chrono::steady_clock::now();
+  fft_plan = plan_fft_many_r2c(config.fft_size, config.channels, fft_input,
+                               fft_output);
+  beat_tracker.plan();
+  pitch_tracker.plan(config.sample_rate);
+  if (config.multi_resolution)
+    multi_resolution = std::make_unique<MultiResolutionAnalyser>(
+        capture_ring, config.sample_rate, config.channels,
+        MultiResolutionAnalyser::default_resolutions());
+  save_fft_wisdom();
+  plan_ms = std::chrono::duration<float, std::milli>(
+                std::chrono::steady_clock::now() - t0)
+                .count();
+  std::cout << "[audio] FFT plans ready in " << plan_ms << " ms ("
+            << (wisdom_loaded ? "warm" : "cold") << " wisdom cache)\n";
 }
 
-std::vector<float> get_fft_data() {
-  std::lock_guard<std::mutex> lock(fft_mutex);
-  return fft_magnitudes;
+static bool open_pipeline(AudioConfig config) {
+  source = make_audio_source(config.source);
+  if (!source) {
+    std::cerr << "[audio] Unknown source: " << config.source << '\n';
+    return false;
+  }
+  if (!source->open(config)) {
+    source.reset();
+    return false;
+  }
+  // A device cannot be slowed down, so it is always analysed as live:
+  // never throttled, skipping ahead when behind, stamped with arrival times.
+  if (!source->paced())
+    config.realtime = true;
+
+  create_fft(config);
+  analysed_position = capture_ring.head();
+  capture_throttled = !config.realtime;
+  configure_block_trackers(config);
+  analysis_running = true;
+  analysis_thread = std::thread(analysis_loop, config);
+  if (multi_resolution && config.realtime)
+    multi_resolution->start();
+
+  capture_channels = config.channels;
+  if (!source->start(capture_block, nullptr)) {
+    close_pipeline();
+    return false;
+  }
+
+  audio_stopped = false;
+  std::lock_guard<std::mutex> lock(config_mutex);
+  active_config = config;
+  return true;
+}
+
+void start_audio(const AudioConfig &config) {
+  for (int i = 0; i < 3; ++i)
+    spectrum_frames.slot(i).magnitudes.assign(config.fft_size / 2, 0.0f);
+  requested_hop = config.fft_size / 4;
+
+  wisdom_loaded = load_fft_wisdom();
+  if (!open_pipeline(config) && config.source != "portaudio") {
+    AudioConfig fallback = config;
+    fallback.source = "portaudio";
+    if (!open_pipeline(fallback)) {
+      std::cerr << "[audio] No source could be opened; audio is stopped\n";
+      audio_stopped = true;
+    }
+  }
+}
+
+bool start_offline_audio(const AudioConfig &config) {
+  for (int i = 0; i < 3; ++i)
+    spectrum_frames.slot(i).magnitudes.assign(config.fft_size / 2, 0.0f);
+  requested_hop = config.fft_size / 4;
+
+  wisdom_loaded = load_fft_wisdom();
+  AudioConfig offline = config;
+  offline.realtime = false;
+  create_fft(offline);
+  capture_channels = offline.channels;
+  configure_block_trackers(offline);
+  offline_analyser = std::make_unique<Analyser>(offline);
+
+  std::lock_guard<std::mutex> lock(config_mutex);
+  active_config = offline;
+  return true;
+}
+
+void feed_audio(const float *interleaved, size_t frames) {
+  if (!offline_analyser)
+    return;
+  // After each drain fewer than fft_size samples are unread, so chunks of
+  // half the ring can never lap the analyser.
+  const size_t chunk = capture_ring.capacity() / 2;
+  while (frames > 0) {
+    size_t n = std::min(frames, chunk);
+    capture_ring.write_interleaved(interleaved, n, capture_channels);
+    track_block(interleaved, n, capture_channels);
+    while (offline_analyser->step()) {
+    }
+    interleaved += n * capture_channels;
+    frames -= n;
+  }
+}
+
+// Applies pending configurations until none is left. Falls back to the
+// previous configuration if the device rejects the new one.
+static void reconfigure_loop() {
+  for (;;) {
+    AudioConfig next, previous;
+    {
+      std::lock_guard<std::mutex> lock(config_mutex);
+      if (!pending_config) {
+        reconfiguring = false;
+        return;
+      }
+      next = *pending_config;
+      previous = active_config;
+      pending_config.reset();
+    }
+
+    close_pipeline();
+    if (next.fft_size != previous.fft_size)
+      requested_hop = std::max(
+          1, int(int64_t(requested_hop) * next.fft_size / previous.fft_size));
+    if (!open_pipeline(next)) {
+      requested_hop = std::max(1, int(int64_t(requested_hop) *
+                                      previous.fft_size / next.fft_size));
+      if (!open_pipeline(previous)) {
+        std::cerr << "[audio] Could not restore the previous configuration "
+                     "either; audio is stopped\n";
+        audio_stopped = true;
+      }
+    }
+  }
+}
+
+void reconfigure_audio(const AudioConfig &config) {
+  std::lock_guard<std::mutex> lock(config_mutex);
+  pending_config = config;
+  if (reconfiguring)
+    return;
+  if (config_thread.joinable())
+    config_thread.join();
+  reconfiguring = true;
+  config_thread = std::thread(reconfigure_loop);
+}
+
+bool is_reconfiguring_audio() { return reconfiguring; }
+
+bool is_audio_stopped() { return audio_stopped; }
+
+AudioConfig get_audio_config() {
+  std::lock_guard<std::mutex> lock(config_mutex);
+  return active_config;
+}
+
+void stop_audio() {
+  {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    pending_config.reset();
+  }
+  if (config_thread.joinable())
+    config_thread.join();
+  close_pipeline();
+}
+
+AudioStats get_audio_stats() {
+  AudioStats stats;
+  stats.callback_last_us = callback_last_us.load(std::memory_order_relaxed);
+  stats.callback_max_us = callback_max_us.load(std::memory_order_relaxed);
+  stats.callback_count = callback_count.load(std::memory_order_relaxed);
+  stats.dropped_blocks = dropped_blocks.load(std::memory_order_relaxed);
+  stats.plan_ms = plan_ms;
+  stats.wisdom_loaded = wisdom_loaded;
+  stats.cq_us = cq_us.load(std::memory_order_relaxed);
+  stats.mel_us = mel_us.load(std::memory_order_relaxed);
+  stats.features_us = features_us.load(std::memory_order_relaxed);
+  stats.pitch_us = pitch_us.load(std::memory_order_relaxed);
+  stats.hpss_us = hpss_us.load(std::memory_order_relaxed);
+  stats.cq_nonzeros = cq_nonzeros.load(std::memory_order_relaxed);
+  stats.onset_latency_ms = onset_latency_ms.load(std::memory_order_relaxed);
+  stats.onset_latency_max_ms =
+      onset_latency_max_ms.load(std::memory_order_relaxed);
+  stats.onsets = onset_count.load(std::memory_order_relaxed);
+  stats.onsets_dropped = onset_events.dropped();
+  stats.tempo_bpm = tempo_bpm.load(std::memory_order_relaxed);
+  stats.tempo_confidence = tempo_confidence.load(std::memory_order_relaxed);
+  return stats;
+}
+
+const SampleRing &get_capture_ring() { return capture_ring; }
+
+bool poll_onset(OnsetEvent &event) { return onset_events.pop(event); }
+
+void set_analysis_settings(const AnalysisSettings &settings) {
+  requested_window.store(settings.window, std::memory_order_relaxed);
+  requested_hop.store(settings.hop_size, std::memory_order_relaxed);
+  requested_cq_bins.store(settings.cq_bins_per_octave,
+                          std::memory_order_relaxed);
+  requested_mel_bands.store(settings.mel_bands, std::memory_order_relaxed);
+  requested_mfccs.store(settings.mfcc_coefficients,
+                        std::memory_order_relaxed);
+  filterbank_enabled.store(settings.band_filterbank,
+                           std::memory_order_relaxed);
+}
+
+AnalysisSettings get_analysis_settings() {
+  return {requested_window.load(std::memory_order_relaxed),
+          requested_hop.load(std::memory_order_relaxed),
+          requested_cq_bins.load(std::memory_order_relaxed),
+          requested_mel_bands.load(std::memory_order_relaxed),
+          requested_mfccs.load(std::memory_order_relaxed),
+          filterbank_enabled.load(std::memory_order_relaxed)};
+}
+
+SpectrumView acquire_spectrum() {
+  spectrum_frames.update();
+  const SpectrumFrame &frame = spectrum_frames.front();
+  return {frame.sequence,    frame.timestamp,   frame.magnitudes,
+          frame.channels,    frame.channel_magnitudes,
+          frame.mid,         frame.side,        frame.cq,
+          frame.cq_min_freq, frame.cq_bins_per_octave,
+          frame.mel,         frame.mfcc,
+          frame.captured_at, frame.bands,
+          frame.band_info,   frame.next_beat,
+          frame.beat_period, frame.tempo_confidence,
+          frame.features,    frame.pitch_hz,
+          frame.pitch_confidence,
+          frame.chroma,      frame.key,
+          frame.key_strength, frame.harmonic,
+          frame.percussive,  frame.percussive_bass,
+          frame.percussive_fraction};
+}
+
+void set_tracked_frequencies(std::span<const float> hz) {
+  ToneRequest &request = tone_requests.back();
+  request.count = int(std::min(hz.size(), std::size(request.hz)));
+  std::copy_n(hz.begin(), request.count, request.hz);
+  tone_requests.publish();
+}
+
+ToneView acquire_tones() {
+  tone_frames.update();
+  const ToneFrame &frame = tone_frames.front();
+  return {frame.timestamp, frame.captured_at,
+          {frame.tones, size_t(frame.count)}};
 }
 
 float quadVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
@@ -136,22 +998,22 @@ void AudioPlayer::initGoo() {
   }
 }
 
-void AudioPlayer::updateGoo(float dt, float bass) {
-
-  static float dropletCooldown = 0.0f;
-  dropletCooldown -= dt;
+// One droplet per onset; harder hits fling it faster. The detector already
+// enforces a minimum gap between onsets, so no cooldown is needed here.
+void AudioPlayer::updateGoo(std::span<const OnsetEvent> onsets) {
 
-  if (bass > 0.2f && dropletCooldown <= 0.0f && gooBlobs.size() < 64) {
+  for (const OnsetEvent &onset : onsets) {
+    if (gooBlobs.size() >= 64)
+      break;
     GooBlob droplet;
     droplet.pos = gooBlobs[0].pos;
 
     float angle = float(rand()) / RAND_MAX * 6.2831f;
-    float speed = 0.3f + bass * 1.5f;
+    float speed = 0.3f + 0.3f * std::min(onset.strength, 4.0f);
     droplet.velocity = glm::vec2(cos(angle), sin(angle)) * speed * 0.01f;
     droplet.radius = 0.015f;
 
     gooBlobs.push_back(droplet);
-    dropletCooldown = 0.1f; // 100ms between droplets
 
     std::cout << "Spawned droplet! Total: " << gooBlobs.size() << "\n";
   }
@@ -169,13 +1031,12 @@ void AudioPlayer::init() {
   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
   glEnableVertexAttribArray(0);
 
-  GLsizei uboSize = sizeof(float) * 4 * NUM_BARS;
+  GLsizei uboSize = sizeof(float) * uniformBlock.size();
   glGenBuffers(1, &ubo_fft);
   glBindBuffer(GL_UNIFORM_BUFFER, ubo_fft);
 
   glBufferData(GL_UNIFORM_BUFFER, uboSize, nullptr, GL_DYNAMIC_DRAW);
   glBindBufferRange(GL_UNIFORM_BUFFER, 0, ubo_fft, 0, uboSize);
-  start_audio();
   initGoo();
 
   glEnable(GL_BLEND);
@@ -229,14 +1090,6 @@ void AudioPlayer::init() {
   }
 
   shadermode = 0;
-  barRanges.reserve(NUM_BARS);
-  for (int i = 0; i < NUM_BARS; ++i) {
-    float start = std::pow(float(i) / NUM_BARS, 2.2f) * (FFT_SIZE / 2);
-    float end = std::pow(float(i + 1) / NUM_BARS, 2.2f) * (FFT_SIZE / 2);
-    int b0 = std::clamp(int(start), 0, FFT_SIZE / 2 - 1);
-    int b1 = std::clamp(int(end), 0, FFT_SIZE / 2 - 1);
-    barRanges.emplace_back(b0, b1);
-  }
 }
 
 void render_circle(float amplitude) {
@@ -259,6 +1112,54 @@ void render_circle(float amplitude) {
 
 void AudioPlayer::render(float *amp, float *time, float dt, int SCR_WIDTH,
                          int SCR_HEIGHT) {
+  SpectrumView spectrum = acquire_spectrum();
+  Loudness loudness = get_loudness();
+  auto t0 = std::chrono::steady_clock::now();
+  spectrumProcessor.process(spectrum.magnitudes,
+                            spectrum.bands.empty() ? spectrum.cq
+                                                   : spectrum.bands,
+                            loudness.momentary_lufs,
+                            loudness.programme_lufs, dt);
+  barMappingUs = std::chrono::duration<float, std::micro>(
+                     std::chrono::steady_clock::now() - t0)
+                     .count();
+  // Beat phase at the moment this frame should reach the screen. Live
+  // audio is extrapolated from its capture time; offline, the frame's own
+  // audio time is the render time. Without a trustworthy tempo the phase
+  // rests at 1, where the shaders' pulse has decayed away.
+  beatPhaseValue = 1.0f;
+  if (spectrum.beat_period > 0.0f &&
+      spectrum.tempo_confidence >= MIN_BEAT_CONFIDENCE) {
+    double audioNow = spectrum.timestamp;
+    if (spectrum.captured_at > 0.0)
+      audioNow += steady_seconds() - spectrum.captured_at;
+    double beats = (audioNow + beatLeadMs * 1e-3 - spectrum.next_beat) /
+                   spectrum.beat_period;
+    beatPhaseValue = float(beats - std::floor(beats));
+  }
+
+  // Drained every frame so events never pile up behind an inactive mode
+  onsets.clear();
+  for (OnsetEvent event; poll_onset(event);)
+    onsets.push_back(event);
+
+  // Bars, chroma and key in the std140 layout of the shaders' FFTBlock.
+  // Uploaded in every mode so any shader can colour by harmony.
+  std::span<const float> padded = spectrumProcessor.std140();
+  std::copy(padded.begin(), padded.end(), uniformBlock.begin());
+  float *chroma = &uniformBlock[4 * NUM_BARS];
+  for (int i = 0; i < 12; ++i)
+    chroma[4 * i] = spectrum.chroma[i];
+  float *key = &uniformBlock[4 * (NUM_BARS + 12)];
+  key[0] = float(spectrum.key);
+  key[1] = spectrum.key_strength;
+  key[2] = spectrum.key < 0 ? 0.0f : float(spectrum.key % 12);
+  key[3] = spectrum.key >= 12 ? 1.0f : 0.0f;
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo_fft);
+  glBufferData(GL_UNIFORM_BUFFER, uniformBlock.size() * sizeof(float), nullptr,
+               GL_DYNAMIC_DRAW);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, uniformBlock.size() * sizeof(float),
+                  uniformBlock.data());
 
   if (shadermode == 0) { // circle visalizuer or something
     //
@@ -267,48 +1168,11 @@ void AudioPlayer::render(float *amp, float *time, float dt, int SCR_WIDTH,
     glm::mat4 projection = glm::ortho(-aspect, aspect, -1.0f, 1.0f);
     circleShader.setMat4("u_projection", projection);
     circleShader.setFloat("u_time", *time);
+    circleShader.setFloat("u_beatPhase", beatPhaseValue);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, imagetex);
     circleShader.setInt("u_texture", 0);
 
-    static float smoothedBinds[NUM_BARS] = {0.0f};
-    static float runningAvg[NUM_BARS] = {0.0f};
-
-    const float tau = 0.05f;
-    float alpha = std::exp(-dt / tau);
-    const float avgAlpha = 0.995f;  // keeps a long-term average
-    const float compExp = 0.3f;     // <1 = stronger compression of spikes
-    const float globalGain = 0.05f; // 0 = silent, 1 = full sensitivity
-    const float smoothFact = 0.9f;  // closer to 1 = more temporal smoothing
-
-    auto raw = get_fft_data();
-    // Loops over each visual bar that will be drawn
-    for (int i = 0; i < NUM_BARS; ++i) {
-      int b0 = barRanges[i].first;
-      int b1 = barRanges[i].second;
-      float sum = 0.0f;
-      for (int b = b0; b <= b1; b++)
-        sum += raw[b];
-      float v = (b1 >= b0) ? (sum / (b1 - b0 + 1)) : raw[b0];
-      runningAvg[i] = avgAlpha * runningAvg[i] + (1.0f - avgAlpha) * v;
-      float v_eq = v / (runningAvg[i] + 1e-6f);
-      v_eq = std::pow(v_eq, compExp);
-      v_eq *= globalGain;
-      smoothedBinds[i] = alpha * smoothedBinds[i] + (1.0f - alpha) * v_eq;
-    }
-
-    static float padded[4 * NUM_BARS];
-    for (int i = 0; i < NUM_BARS; ++i) {
-      padded[i * 4 + 0] = smoothedBinds[i];
-      padded[i * 4 + 1] = 0.0f;
-      padded[i * 4 + 2] = 0.0f;
-      padded[i * 4 + 3] = 0.0f;
-    }
-
-    glBindBuffer(GL_UNIFORM_BUFFER, ubo_fft);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(padded), nullptr, GL_DYNAMIC_DRAW);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(padded), padded);
-
     glBindVertexArray(vao);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
@@ -319,78 +1183,29 @@ void AudioPlayer::render(float *amp, float *time, float dt, int SCR_WIDTH,
     barShader.setMat4("u_projection", projection);
     barShader.setFloat("u_amplitude", *amp);
     barShader.setFloat("u_time", *time);
+    barShader.setFloat("u_beatPhase", beatPhaseValue);
+    barShader.setFloat("u_percussive", spectrum.percussive_fraction);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, imagetex);
     barShader.setInt("u_texture", 0);
 
-    static float smoothedBinds[NUM_BARS] = {0.0f};
-    static float runningAvg[NUM_BARS] = {0.0f};
-
-    const float tau = 0.05f;
-    float alpha = std::exp(-dt / tau);
-    const float avgAlpha = 0.995f;  // keeps a long-term average
-    const float compExp = 0.3f;     // <1 = stronger compression of spikes
-    const float globalGain = 0.05f; // 0 = silent, 1 = full sensitivity
-    const float smoothFact = 0.9f;  // closer to 1 = more temporal smoothing
-
-    auto raw = get_fft_data();
-    // Loops over each visual bar that will be drawn
-    for (int i = 0; i < NUM_BARS; ++i) {
-      int b0 = barRanges[i].first;
-      int b1 = barRanges[i].second;
-      float sum = 0.0f;
-      for (int b = b0; b <= b1; b++)
-        sum += raw[b];
-      float v = (b1 >= b0) ? (sum / (b1 - b0 + 1)) : raw[b0];
-      runningAvg[i] = avgAlpha * runningAvg[i] + (1.0f - avgAlpha) * v;
-      float v_eq = v / (runningAvg[i] + 1e-6f);
-      v_eq = std::pow(v_eq, compExp);
-      v_eq *= globalGain;
-      smoothedBinds[i] = alpha * smoothedBinds[i] + (1.0f - alpha) * v_eq;
-    }
-
-    static float padded[4 * NUM_BARS];
-    for (int i = 0; i < NUM_BARS; ++i) {
-      padded[i * 4 + 0] = smoothedBinds[i];
-      padded[i * 4 + 1] = 0.0f;
-      padded[i * 4 + 2] = 0.0f;
-      padded[i * 4 + 3] = 0.0f;
-    }
-
-    glBindBuffer(GL_UNIFORM_BUFFER, ubo_fft);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(padded), nullptr, GL_DYNAMIC_DRAW);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(padded), padded);
-
     glBindVertexArray(vao);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
   } else if (shadermode == 2) {
-
-    auto fft = get_fft_data();
-    float bass = 0.0f;
-    float mid = 0.0f;
-    float treble = 0.0f;
-
-    int bass_end = FFT_SIZE / 32;
-    int mid_start = FFT_SIZE / 32;
-    int mid_end = FFT_SIZE / 8;
-    int treble_start = FFT_SIZE / 8;
-
-    for (int i = 0; i < fft.size(); ++i) {
-      if (i < bass_end)
-        bass += fft[i];
-      else if (i < mid_end)
-        mid += fft[i];
-      else
-        treble += fft[i];
+    // Drum hits rather than held bass notes swell the goo
+    float bass = spectrum.percussive_bass;
+    float mid = spectrum.features.mid;
+    float treble = spectrum.features.treble;
+    if (filterbank_enabled.load(std::memory_order_relaxed)) {
+      bass = band_envelopes[0].load(std::memory_order_relaxed);
+      mid = band_envelopes[1].load(std::memory_order_relaxed);
+      treble = band_envelopes[2].load(std::memory_order_relaxed);
     }
-
-    bass /= bass_end;
-    mid /= (mid_end - mid_start);
-    treble /= (fft.size() - treble_start);
-    updateGoo(dt, bass);
+    updateGoo(onsets);
     globShader.use();
     // rainShader.setFloat("u_amplitude", *amp);
     globShader.setFloat("u_time", *time);
+    globShader.setFloat("u_beatPhase", beatPhaseValue);
     globShader.setFloat("u_bass", bass);
     globShader.setFloat("u_mid", mid);
     globShader.setFloat("u_treble", treble);
@@ -0,0 +1,226 @@
+#include "audio_source.h"
+#include "wav_reader.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <portaudio.h>
+
+// ---------------------------------------------------------------------------
+// PortAudio: default input device, delivered from PortAudio's callback
+
+class PortAudioSource : public AudioSource {
+public:
+  bool open(AudioConfig &config) override {
+    Pa_Initialize();
+    initialized = true;
+    PaError err = Pa_OpenDefaultStream(&stream, config.channels, 0, paFloat32,
+                                       config.sample_rate,
+                                       config.frames_per_buffer, callback,
+                                       this);
+    if (err != paNoError) {
+      std::cerr << "[audio] Could not open " << config.channels
+                << "-channel input at " << config.sample_rate << " Hz / "
+                << config.frames_per_buffer
+                << " frames: " << Pa_GetErrorText(err) << '\n';
+      stream = nullptr;
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  bool start(AudioSink sink, void *user) override {
+    this->sink = sink;
+    this->user = user;
+    PaError err = Pa_StartStream(stream);
+    if (err != paNoError) {
+      std::cerr << "[audio] Could not start input: " << Pa_GetErrorText(err)
+                << '\n';
+      return false;
+    }
+    return true;
+  }
+
+  void close() override {
+    if (stream) {
+      Pa_StopStream(stream);
+      Pa_CloseStream(stream);
+      stream = nullptr;
+    }
+    if (initialized)
+      Pa_Terminate();
+    initialized = false;
+  }
+
+  std::string name() const override { return "portaudio"; }
+
+  ~PortAudioSource() override { close(); }
+
+private:
+  static int callback(const void *input, void *, unsigned long frames,
+                      const PaStreamCallbackTimeInfo *, PaStreamCallbackFlags,
+                      void *self) {
+    auto *src = static_cast<PortAudioSource *>(self);
+    src->sink(static_cast<const float *>(input), frames, src->user);
+    return paContinue;
+  }
+
+  PaStream *stream = nullptr;
+  bool initialized = false;
+  AudioSink sink = nullptr;
+  void *user = nullptr;
+};
+
+// ---------------------------------------------------------------------------
+// Paced sources
+
+bool PacedSource::start(AudioSink sink, void *user) {
+  block.assign(size_t(config.frames_per_buffer) * config.channels, 0.0f);
+  running = true;
+  thread = std::thread(&PacedSource::run, this, sink, user);
+  return true;
+}
+
+void PacedSource::close() {
+  running = false;
+  if (thread.joinable())
+    thread.join();
+}
+
+void PacedSource::run(AudioSink sink, void *user) {
+  using clock = std::chrono::steady_clock;
+  const auto period = std::chrono::duration<double>(
+      double(config.frames_per_buffer) / config.sample_rate);
+  auto next = clock::now();
+  while (running) {
+    if (!render(block.data(), config.frames_per_buffer))
+      break;
+    sink(block.data(), config.frames_per_buffer, user);
+    if (!config.realtime)
+      continue;
+    next += std::chrono::duration_cast<clock::duration>(period);
+    std::this_thread::sleep_until(next);
+  }
+}
+
+// Streams a WAV file at its own rate and channel count, looping at the end.
+class WavFileSource : public PacedSource {
+public:
+  explicit WavFileSource(std::string path) : path(std::move(path)) {}
+
+  bool open(AudioConfig &cfg) override {
+    if (auto result = reader.open(path); !result) {
+      std::cerr << "[audio] " << result.error() << '\n';
+      return false;
+    }
+    if (reader.channels() > 8) {
+      std::cerr << "[audio] " << path << " has more than 8 channels\n";
+      return false;
+    }
+    cfg.sample_rate = reader.sample_rate();
+    cfg.channels = reader.channels();
+    config = cfg;
+    return true;
+  }
+
+  std::string name() const override { return "file:" + path; }
+
+  ~WavFileSource() override { close(); }
+
+protected:
+  bool render(float *out, size_t frames) override {
+    size_t done = 0;
+    while (done < frames) {
+      size_t got = reader.read(out + done * config.channels, frames - done);
+      if (got == 0) {
+        if (reader.frames() == 0)
+          return false;
+        reader.seek(0);
+      }
+      done += got;
+    }
+    return true;
+  }
+
+private:
+  std::string path;
+  WavReader reader;
+};
+
+// Test signals: a logarithmic sine sweep (20 Hz - 20 kHz over 10 s), white
+// noise, or an impulse train at 120 BPM. Same signal on every channel.
+class SyntheticSource : public PacedSource {
+public:
+  enum class Kind { Sweep, Noise, Impulse };
+
+  explicit SyntheticSource(Kind kind) : kind(kind) {}
+
+  bool open(AudioConfig &cfg) override {
+    config = cfg;
+    return true;
+  }
+
+  std::string name() const override {
+    switch (kind) {
+    case Kind::Sweep:
+      return "synth:sweep";
+    case Kind::Noise:
+      return "synth:noise";
+    case Kind::Impulse:
+      return "synth:impulse";
+    }
+    return "synth";
+  }
+
+  ~SyntheticSource() override { close(); }
+
+protected:
+  bool render(float *out, size_t frames) override {
+    const double sr = config.sample_rate;
+    for (size_t i = 0; i < frames; ++i, ++n) {
+      float v = 0.0f;
+      switch (kind) {
+      case Kind::Sweep: {
+        const double f0 = 20.0, f1 = 20000.0, length = 10.0;
+        double t = std::fmod(n / sr, length);
+        double k = std::log(f1 / f0) / length;
+        v = 0.5f * float(std::sin(2.0 * M_PI * f0 * (std::exp(k * t) - 1.0) /
+                                  k));
+        break;
+      }
+      case Kind::Noise:
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        v = 0.5f * (float(rng) / 4294967296.0f * 2.0f - 1.0f);
+        break;
+      case Kind::Impulse:
+        v = (n % uint64_t(sr * 0.5) == 0) ? 1.0f : 0.0f;
+        break;
+      }
+      for (int c = 0; c < config.channels; ++c)
+        out[i * config.channels + c] = v;
+    }
+    return true;
+  }
+
+private:
+  Kind kind;
+  uint64_t n = 0;
+  uint32_t rng = 0x12345678u;
+};
+
+std::unique_ptr<AudioSource> make_audio_source(const std::string &spec) {
+  if (spec == "portaudio")
+    return std::make_unique<PortAudioSource>();
+  if (spec.rfind("file:", 0) == 0)
+    return std::make_unique<WavFileSource>(spec.substr(5));
+  if (spec == "synth:sweep")
+    return std::make_unique<SyntheticSource>(SyntheticSource::Kind::Sweep);
+  if (spec == "synth:noise")
+    return std::make_unique<SyntheticSource>(SyntheticSource::Kind::Noise);
+  if (spec == "synth:impulse")
+    return std::make_unique<SyntheticSource>(SyntheticSource::Kind::Impulse);
+  return nullptr;
+}
@@ -0,0 +1,160 @@
+#include "beat_tracker.h"
+#include "fft_plans.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int ENVELOPE_RATE = 100;    // novelty slots per second
+constexpr size_t ENVELOPE_LENGTH = 600; // six seconds
+constexpr size_t MIN_FILL = 300;      // three seconds before a first guess
+constexpr int ESTIMATE_EVERY = 25;    // slots between tempo estimates
+// Twice the envelope, so the circular correlation never wraps
+constexpr int ACF_SIZE = 2048;
+constexpr double MIN_BPM = 60.0, MAX_BPM = 200.0;
+constexpr double PRIOR_BPM = 120.0;   // centre of the tempo prior
+constexpr double PRIOR_OCTAVES = 1.0; // its width (log2 standard deviation)
+constexpr float MIN_CONFIDENCE = 0.1f;
+constexpr double RELOCK = 0.08; // tempo change that restarts the loop
+constexpr double TEMPO_PULL = 0.2;
+constexpr double CAPTURE = 0.25; // onsets further off a beat are ignored
+constexpr double PHASE_GAIN = 0.2;
+constexpr double PERIOD_GAIN = 0.05;
+} // namespace
+
+BeatTracker::~BeatTracker() {
+  if (forward)
+    fftwf_destroy_plan(forward);
+  if (inverse)
+    fftwf_destroy_plan(inverse);
+  fftwf_free(acf);
+  fftwf_free(spectrum);
+}
+
+void BeatTracker::plan() {
+  if (forward)
+    return;
+  acf = fftwf_alloc_real(ACF_SIZE);
+  spectrum = fftwf_alloc_complex(ACF_SIZE / 2 + 1);
+  forward = plan_fft_r2c(ACF_SIZE, acf, spectrum);
+  inverse = plan_fft_c2r(ACF_SIZE, spectrum, acf);
+  envelope.assign(ENVELOPE_LENGTH, 0.0f);
+}
+
+void BeatTracker::add_frame(double time, float novelty) {
+  if (!forward)
+    return;
+  // Each 10 ms slot keeps the strongest novelty that fell into it
+  const long long s = (long long)std::floor(time * ENVELOPE_RATE);
+  if (slot < 0)
+    slot = s;
+  if (s > slot) {
+    // Close the current slot, plus empty ones if frames were skipped
+    size_t closed = size_t(std::min<long long>(s - slot, ENVELOPE_LENGTH));
+    for (size_t i = 0; i < closed; ++i) {
+      envelope[envelopeAt] = i == 0 ? slotPeak : 0.0f;
+      envelopeAt = (envelopeAt + 1) % ENVELOPE_LENGTH;
+    }
+    envelopeFilled = std::min(ENVELOPE_LENGTH, envelopeFilled + closed);
+    slotsSinceEstimate += int(closed);
+    slot = s;
+    slotPeak = 0.0f;
+    if (slotsSinceEstimate >= ESTIMATE_EVERY && envelopeFilled >= MIN_FILL) {
+      slotsSinceEstimate = 0;
+      estimate_tempo();
+    }
+  }
+  slotPeak = std::max(slotPeak, novelty);
+
+  // Keep the flywheel one beat ahead of the analysis
+  if (period > 0.0 && nextBeat <= time)
+    nextBeat += std::floor((time - nextBeat) / period + 1.0) * period;
+}
+
+void BeatTracker::add_onset(double time, float strength) {
+  if (period <= 0.0)
+    return;
+  double beats = std::round((time - nextBeat) / period);
+  double error = time - (nextBeat + beats * period);
+  if (std::abs(error) > CAPTURE * period)
+    return;
+  double weight = std::min(strength, 3.0f) / 3.0;
+  nextBeat += PHASE_GAIN * weight * error;
+  period = std::clamp(period + PERIOD_GAIN * weight * error, 60.0 / MAX_BPM,
+                      60.0 / MIN_BPM);
+}
+
+void BeatTracker::estimate_tempo() {
+  // Oldest slot first, mean removed so the DC level does not swamp the
+  // periodicity
+  const size_t n = envelopeFilled;
+  const size_t first = (envelopeAt + ENVELOPE_LENGTH - n) % ENVELOPE_LENGTH;
+  double mean = 0.0;
+  for (size_t i = 0; i < n; ++i)
+    mean += envelope[(first + i) % ENVELOPE_LENGTH];
+  mean /= n;
+  for (size_t i = 0; i < n; ++i)
+    acf[i] = float(envelope[(first + i) % ENVELOPE_LENGTH] - mean);
+  std::fill(acf + n, acf + ACF_SIZE, 0.0f);
+
+  // Wiener-Khinchin: the autocorrelation is the inverse FFT of the power
+  fftwf_execute(forward);
+  for (int k = 0; k <= ACF_SIZE / 2; ++k) {
+    spectrum[k][0] =
+        spectrum[k][0] * spectrum[k][0] + spectrum[k][1] * spectrum[k][1];
+    spectrum[k][1] = 0.0f;
+  }
+  fftwf_execute(inverse);
+  if (acf[0] <= 1e-12f) {
+    tempoConfidence = 0.0f;
+    return;
+  }
+
+  // Score each lag with its first multiple too, so the true beat beats
+  // its own half-period sub-harmonics
+  const int minLag = int(std::ceil(ENVELOPE_RATE * 60.0 / MAX_BPM));
+  const int maxLag = int(std::floor(ENVELOPE_RATE * 60.0 / MIN_BPM));
+  int best = minLag;
+  double bestScore = -1e30;
+  for (int lag = minLag; lag <= maxLag; ++lag) {
+    double octaves = std::log2(ENVELOPE_RATE * 60.0 / lag / PRIOR_BPM);
+    double prior =
+        std::exp(-0.5 * octaves * octaves / (PRIOR_OCTAVES * PRIOR_OCTAVES));
+    double score = prior * (acf[lag] + 0.5 * acf[2 * lag]);
+    if (score > bestScore) {
+      bestScore = score;
+      best = lag;
+    }
+  }
+  tempoConfidence = std::clamp(acf[best] / acf[0], 0.0f, 1.0f);
+  if (tempoConfidence < MIN_CONFIDENCE)
+    return;
+
+  // Parabolic interpolation around the peak for sub-slot precision
+  double y0 = acf[best - 1], y1 = acf[best], y2 = acf[best + 1];
+  double denom = y0 - 2.0 * y1 + y2;
+  double offset = denom < 0.0 ? 0.5 * (y0 - y2) / denom : 0.0;
+  double tempoPeriod = (best + std::clamp(offset, -0.5, 0.5)) / ENVELOPE_RATE;
+
+  if (period > 0.0 && std::abs(tempoPeriod / period - 1.0) <= RELOCK) {
+    period += TEMPO_PULL * (tempoPeriod - period);
+    return;
+  }
+
+  // (Re)lock: the beat grid goes where a comb at the new period collects
+  // the most novelty over the last few beats. The newest closed slot is
+  // the one before `slot`.
+  period = tempoPeriod;
+  int bestOffset = 0;
+  float bestSum = -1.0f;
+  for (int offset = 0; offset < best; ++offset) {
+    float sum = 0.0f;
+    for (size_t at = offset; at < n; at += best)
+      sum += envelope[(envelopeAt + ENVELOPE_LENGTH - 1 - at) %
+                      ENVELOPE_LENGTH];
+    if (sum > bestSum) {
+      bestSum = sum;
+      bestOffset = offset;
+    }
+  }
+  nextBeat = (slot - bestOffset - 0.5) / ENVELOPE_RATE;
+}
@@ -0,0 +1,69 @@
+#include "biquad_filterbank.h"
+#include "dsp_kernels.h"
+#include <cmath>
+
+namespace {
+constexpr int STAGES = 4; // two per edge: high-pass below, low-pass above
+
+struct Biquad {
+  float b0, b1, b2, a1, a2;
+};
+
+constexpr Biquad IDENTITY = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+
+// Butterworth (Q = 1/sqrt(2)) sections from the RBJ cookbook
+Biquad butterworth(int sampleRate, float freq, bool highPass) {
+  const double w = 2.0 * M_PI * freq / sampleRate;
+  const double alpha = std::sin(w) / std::sqrt(2.0);
+  const double cosw = std::cos(w);
+  const double a0 = 1.0 + alpha;
+  const double b1 = highPass ? -(1.0 + cosw) : 1.0 - cosw;
+  const double b0 = highPass ? (1.0 + cosw) / 2.0 : (1.0 - cosw) / 2.0;
+  return {float(b0 / a0), float(b1 / a0), float(b0 / a0),
+          float(-2.0 * cosw / a0), float((1.0 - alpha) / a0)};
+}
+} // namespace
+
+void BiquadFilterbank::configure(int sampleRate,
+                                 const std::vector<float> &crossovers,
+                                 float attackMs, float releaseMs) {
+  numBands = int(crossovers.size()) + 1;
+  paddedBands = (numBands + BIQUAD_LANES - 1) / BIQUAD_LANES * BIQUAD_LANES;
+  coeffs.assign(5 * STAGES * paddedBands, 0.0f);
+  state.assign(2 * STAGES * paddedBands, 0.0f);
+  follower.assign(2 * paddedBands, 0.0f);
+  envelopes.assign(paddedBands, 0.0f);
+
+  const float attack = 1.0f - std::exp(-1e3f / (attackMs * sampleRate));
+  const float release = 1.0f - std::exp(-1e3f / (releaseMs * sampleRate));
+  for (int b = 0; b < paddedBands; ++b) {
+    // Padding lanes get all-zero coefficients and stay silent
+    Biquad stages[STAGES] = {};
+    if (b < numBands) {
+      Biquad high = b > 0 ? butterworth(sampleRate, crossovers[b - 1], true)
+                          : IDENTITY;
+      Biquad low = b + 1 < numBands
+                       ? butterworth(sampleRate, crossovers[b], false)
+                       : IDENTITY;
+      stages[0] = stages[1] = high;
+      stages[2] = stages[3] = low;
+    }
+    for (int s = 0; s < STAGES; ++s) {
+      float *c = &coeffs[5 * s * paddedBands + b];
+      c[0] = stages[s].b0;
+      c[paddedBands] = stages[s].b1;
+      c[2 * paddedBands] = stages[s].b2;
+      c[3 * paddedBands] = stages[s].a1;
+      c[4 * paddedBands] = stages[s].a2;
+    }
+    follower[b] = attack;
+    follower[paddedBands + b] = release;
+  }
+}
+
+void BiquadFilterbank::process(const float *mono, size_t n) {
+  if (numBands == 0)
+    return;
+  biquad_bank_envelope(mono, n, coeffs.data(), state.data(), STAGES,
+                       paddedBands, follower.data(), envelopes.data());
+}
@@ -0,0 +1,110 @@
+#include "chroma.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+constexpr float C0_HZ = 16.351598f;
+constexpr float MIN_HZ = 65.0f;   // C2
+constexpr float MAX_HZ = 5000.0f; // above this harmonics outweigh notes
+constexpr float SEMITONE = 1.0594631f;
+constexpr float KEY_TAU = 8.0f; // seconds of harmony the key follows
+constexpr double SILENCE = 1e-12;
+
+// Krumhansl and Kessler's probe-tone ratings, tonic first
+constexpr double MAJOR[12] = {6.35, 2.23, 3.48, 2.33, 4.38, 4.09,
+                              2.52, 5.19, 2.39, 3.66, 2.29, 2.88};
+constexpr double MINOR[12] = {6.33, 2.68, 3.52, 5.38, 2.60, 3.53,
+                              2.54, 4.75, 3.98, 2.69, 3.34, 3.17};
+
+double correlation(const std::array<double, 12> &x, const double *profile,
+                   int tonic) {
+  double mx = 0.0, my = 0.0;
+  for (int i = 0; i < 12; ++i) {
+    mx += x[i];
+    my += profile[i];
+  }
+  mx /= 12.0;
+  my /= 12.0;
+  double sxy = 0.0, sxx = 0.0, syy = 0.0;
+  for (int i = 0; i < 12; ++i) {
+    double dx = x[(tonic + i) % 12] - mx, dy = profile[i] - my;
+    sxy += dx * dy;
+    sxx += dx * dx;
+    syy += dy * dy;
+  }
+  return sxx > 0.0 ? sxy / std::sqrt(sxx * syy) : 0.0;
+}
+} // namespace
+
+void Chromagram::configure_fft(int bins, int sampleRate, int fftSize) {
+  entries.clear();
+  const float binHz = float(sampleRate) / fftSize;
+  // A bin resolves a semitone once the step to the next one is at least a
+  // bin wide
+  const float lowest = std::max(MIN_HZ, binHz / (SEMITONE - 1.0f));
+  for (int k = 1; k < bins; ++k) {
+    const float f = k * binHz;
+    if (f < lowest || f > MAX_HZ)
+      continue;
+    const int semitone = int(std::lround(12.0f * std::log2(f / C0_HZ)));
+    entries.push_back({uint32_t(k), uint8_t(semitone % 12), 1.0f});
+  }
+  mappedBins = bins;
+  mappedBinsPerOctave = 0;
+}
+
+void Chromagram::configure_cq(int bins, int binsPerOctave) {
+  entries.clear();
+  for (int k = 0; k < bins; ++k) {
+    // C1 is pitch class 0
+    const float position = 12.0f * k / binsPerOctave;
+    const int below = int(std::floor(position));
+    const float above = position - below;
+    entries.push_back({uint32_t(k), uint8_t(below % 12), 1.0f - above});
+    if (above > 0.0f)
+      entries.push_back({uint32_t(k), uint8_t((below + 1) % 12), above});
+  }
+  mappedBins = bins;
+  mappedBinsPerOctave = binsPerOctave;
+}
+
+void Chromagram::process(std::span<const float> magnitudes, float hopSeconds,
+                         std::array<float, PITCH_CLASSES> &chroma) {
+  std::array<double, PITCH_CLASSES> energy{};
+  for (const Entry &e : entries) {
+    const float m = magnitudes[e.bin];
+    energy[e.pitchClass] += e.weight * m * m;
+  }
+  const double total = std::accumulate(energy.begin(), energy.end(), 0.0);
+  if (total <= SILENCE) {
+    chroma.fill(0.0f);
+    return;
+  }
+  const double peak = *std::max_element(energy.begin(), energy.end());
+  for (int i = 0; i < PITCH_CLASSES; ++i)
+    chroma[i] = float(energy[i] / peak);
+
+  // The average is of unit-sum chroma, so loud passages do not dominate
+  const double a = std::exp(-hopSeconds / KEY_TAU);
+  for (int i = 0; i < PITCH_CLASSES; ++i)
+    running[i] = a * running[i] + (1.0 - a) * energy[i] / total;
+  estimate_key();
+}
+
+void Chromagram::estimate_key() {
+  double best = -2.0;
+  for (int tonic = 0; tonic < PITCH_CLASSES; ++tonic) {
+    const double major = correlation(running, MAJOR, tonic);
+    const double minor = correlation(running, MINOR, tonic);
+    if (major > best) {
+      best = major;
+      bestKey = tonic;
+    }
+    if (minor > best) {
+      best = minor;
+      bestKey = PITCH_CLASSES + tonic;
+    }
+  }
+  keyStrength = float(best);
+}
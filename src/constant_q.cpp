@@ -0,0 +1,86 @@
+#include "constant_q.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+using cdouble = std::complex<double>;
+
+// Sum of e^(i theta m) for m = 0 .. length - 1.
+static cdouble geometric_sum(double theta, int length) {
+  double s = std::sin(0.5 * theta);
+  if (std::abs(s) < 1e-12)
+    return double(length);
+  return std::polar(std::sin(0.5 * length * theta) / s,
+                    0.5 * (length - 1) * theta);
+}
+
+void ConstantQ::configure(int fftSize, int sampleRate, int bpo,
+                          const std::vector<float> &window, float minFreq) {
+  rows.clear();
+  coeffs.clear();
+  centreFreqs.clear();
+  binsPerOctave = bpo;
+  if (bpo <= 0)
+    return;
+
+  const double n = fftSize;
+  const double fs = sampleRate;
+  const double q = 1.0 / (std::exp2(1.0 / bpo) - 1.0);
+  const int half = fftSize / 2;
+  fullQFreq = float(q * fs / n);
+
+  for (int k = 0;; ++k) {
+    const double freq = minFreq * std::exp2(double(k) / bpo);
+    if (freq > 0.45 * fs)
+      break;
+    const int length = std::min(fftSize, int(std::ceil(q * fs / freq)));
+    const int start = (fftSize - length) / 2;
+    const double omega = 2.0 * M_PI * freq / fs;
+    const double step = 2.0 * M_PI / length;
+
+    // A unit cosine at `freq` correlates to gain / 2 with the windowed
+    // kernel; 1 / n is Parseval's factor for the frequency-domain product.
+    double gain = 0.0;
+    for (int m = 0; m < length; ++m)
+      gain += window[start + m] * (0.5 - 0.5 * std::cos(step * m));
+    const double scale = 2.0 / (gain * n);
+
+    // Spectrum of the kernel in closed form: the Hann window is three
+    // complex exponentials, each summing to a geometric series. Only the
+    // main lobe and near side lobes around the centre bin matter.
+    const double centre = freq * n / fs;
+    const double spread = 4.0 * n / length + 2.0;
+    const int j0 = std::max(0, int(std::floor(centre - spread)));
+    const int j1 = std::min(half, int(std::ceil(centre + spread)));
+    std::vector<cdouble> band(j1 - j0 + 1);
+    double peak = 0.0;
+    for (int j = j0; j <= j1; ++j) {
+      double phi = omega - 2.0 * M_PI * j / n;
+      cdouble t = 0.5 * geometric_sum(phi, length) -
+                  0.25 * geometric_sum(phi + step, length) -
+                  0.25 * geometric_sum(phi - step, length);
+      band[j - j0] = t * std::polar(scale, phi * start);
+      peak = std::max(peak, std::abs(band[j - j0]));
+    }
+
+    // Trim coefficients more than 60 dB below the peak off both ends
+    int first = 0, last = int(band.size()) - 1;
+    while (first < last && std::abs(band[first]) < 1e-3 * peak)
+      ++first;
+    while (last > first && std::abs(band[last]) < 1e-3 * peak)
+      --last;
+
+    rows.push_back({uint32_t(j0 + first), uint32_t(last - first + 1),
+                    uint32_t(coeffs.size() / 2)});
+    for (int i = first; i <= last; ++i) {
+      coeffs.push_back(float(band[i].real()));
+      coeffs.push_back(float(band[i].imag()));
+    }
+    centreFreqs.push_back(float(freq));
+  }
+}
+
+void ConstantQ::process(const float *spectrum, float *out) const {
+  sparse_matvec_magnitude(spectrum, rows.data(), rows.size(), coeffs.data(),
+                          out);
+}
@@ -0,0 +1,1541 @@
+#include "dsp_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DSP_X86 1
+#endif
+
+namespace {
+
+struct DspKernels {
+  const char *isa;
+  void (*window_multiply)(const float *, const float *, float *, size_t);
+  void (*complex_magnitude)(const float *, float *, size_t, float);
+  void (*complex_power)(const float *, float *, size_t);
+  void (*complex_db)(const float *, float *, size_t, float);
+  void (*pcm16_to_float)(const void *, float *, size_t);
+  void (*pcm24_to_float)(const void *, float *, size_t);
+  void (*pcm32_to_float)(const void *, float *, size_t);
+  void (*pow_positive)(const float *, float *, size_t, float);
+  float (*sum)(const float *, size_t);
+  void (*sparse_matvec_magnitude)(const float *, const SparseBand *, size_t,
+                                  const float *, float *);
+  void (*sparse_matvec)(const float *, const SparseBand *, size_t,
+                        const float *, float *);
+  void (*power_db)(const float *, float *, size_t, float);
+  void (*biquad_bank_envelope)(const float *, size_t, const float *, float *,
+                               int, int, const float *, float *);
+  void (*spectral_sums)(const float *, const float *, size_t, float, float *,
+                        SpectralSums &);
+  void (*signal_sums)(const float *, size_t, SignalSums &);
+  void (*median9)(const float *const *, float *, size_t);
+};
+
+constexpr float DB_PER_LN = 4.342944819f; // 10 / ln(10)
+constexpr float PCM16_SCALE = 1.0f / 32768.0f;
+constexpr float PCM32_SCALE = 1.0f / 2147483648.0f;
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+
+void window_multiply_scalar(const float *in, const float *window, float *out,
+                            size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = in[i] * window[i];
+}
+
+void complex_magnitude_scalar(const float *c, float *out, size_t n,
+                              float scale) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = scale * std::sqrt(c[2 * i] * c[2 * i] + c[2 * i + 1] * c[2 * i + 1]);
+}
+
+void complex_power_scalar(const float *c, float *out, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = c[2 * i] * c[2 * i] + c[2 * i + 1] * c[2 * i + 1];
+}
+
+void complex_db_scalar(const float *c, float *out, size_t n,
+                       float floorPower) {
+  for (size_t i = 0; i < n; ++i) {
+    float p = c[2 * i] * c[2 * i] + c[2 * i + 1] * c[2 * i + 1];
+    out[i] = DB_PER_LN * std::log(std::max(p, floorPower));
+  }
+}
+
+void pcm16_to_float_scalar(const void *in, float *out, size_t n) {
+  const unsigned char *p = static_cast<const unsigned char *>(in);
+  for (size_t i = 0; i < n; ++i)
+    out[i] = int16_t(p[2 * i] | (p[2 * i + 1] << 8)) * PCM16_SCALE;
+}
+
+void pcm24_to_float_scalar(const void *in, float *out, size_t n) {
+  const unsigned char *p = static_cast<const unsigned char *>(in);
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t v = (uint32_t(p[3 * i]) << 8) | (uint32_t(p[3 * i + 1]) << 16) |
+                 (uint32_t(p[3 * i + 2]) << 24);
+    out[i] = int32_t(v) * PCM32_SCALE;
+  }
+}
+
+void pcm32_to_float_scalar(const void *in, float *out, size_t n) {
+  const unsigned char *p = static_cast<const unsigned char *>(in);
+  for (size_t i = 0; i < n; ++i) {
+    int32_t v;
+    std::memcpy(&v, p + 4 * i, 4);
+    out[i] = v * PCM32_SCALE;
+  }
+}
+
+void pow_positive_scalar(const float *in, float *out, size_t n,
+                         float exponent) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = in[i] > 0.0f ? std::pow(in[i], exponent) : 0.0f;
+}
+
+float sum_scalar(const float *x, size_t n) {
+  double s = 0.0;
+  for (size_t i = 0; i < n; ++i)
+    s += x[i];
+  return float(s);
+}
+
+void sparse_matvec_magnitude_scalar(const float *x, const SparseBand *rows,
+                                    size_t numRows, const float *coeffs,
+                                    float *out) {
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + 2 * rows[r].start;
+    const float *c = coeffs + 2 * rows[r].offset;
+    float re = 0.0f, im = 0.0f;
+    for (uint32_t j = 0; j < rows[r].length; ++j) {
+      re += a[2 * j] * c[2 * j] + a[2 * j + 1] * c[2 * j + 1];
+      im += a[2 * j + 1] * c[2 * j] - a[2 * j] * c[2 * j + 1];
+    }
+    out[r] = std::sqrt(re * re + im * im);
+  }
+}
+
+void sparse_matvec_scalar(const float *x, const SparseBand *rows,
+                          size_t numRows, const float *weights, float *out) {
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + rows[r].start;
+    const float *w = weights + rows[r].offset;
+    float acc = 0.0f;
+    for (uint32_t j = 0; j < rows[r].length; ++j)
+      acc += a[j] * w[j];
+    out[r] = acc;
+  }
+}
+
+void power_db_scalar(const float *p, float *out, size_t n, float floorPower) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = DB_PER_LN * std::log(std::max(p[i], floorPower));
+}
+
+void biquad_bank_envelope_scalar(const float *in, size_t n,
+                                 const float *coeffs, float *state, int stages,
+                                 int bands, const float *follower,
+                                 float *envelope) {
+  for (int b = 0; b < bands; ++b) {
+    float e = envelope[b];
+    for (size_t i = 0; i < n; ++i) {
+      float x = in[i];
+      for (int s = 0; s < stages; ++s) {
+        const float *c = coeffs + 5 * s * bands + b;
+        float *z = state + 2 * s * bands + b;
+        float y = c[0] * x + z[0];
+        z[0] = c[bands] * x - c[3 * bands] * y + z[bands];
+        z[bands] = c[2 * bands] * x - c[4 * bands] * y;
+        x = y;
+      }
+      float a = std::abs(x);
+      e += (a > e ? follower[b] : follower[bands + b]) * (a - e);
+    }
+    envelope[b] = e;
+  }
+}
+
+// Adds bins [begin, end) to acc (magnitude, weighted, power, log power,
+// flux) and fills their chunks; `begin` is a multiple of SPECTRAL_CHUNK.
+// Also finishes the tails of the vector versions.
+void spectral_sums_range(const float *m, const float *prev, size_t begin,
+                         size_t end, float floorPower, float *chunks,
+                         double acc[5]) {
+  for (size_t c = begin; c < end; c += SPECTRAL_CHUNK) {
+    const size_t stop = std::min(end, c + SPECTRAL_CHUNK);
+    float chunk = 0.0f;
+    for (size_t i = c; i < stop; ++i) {
+      float v = m[i], p = v * v;
+      chunk += v;
+      acc[1] += double(i) * v;
+      acc[2] += p;
+      acc[3] += std::log(std::max(p, floorPower));
+      acc[4] += std::max(v - prev[i], 0.0f);
+    }
+    chunks[c / SPECTRAL_CHUNK] = chunk;
+    acc[0] += chunk;
+  }
+}
+
+void store_spectral_sums(const double acc[5], SpectralSums &out) {
+  out = {float(acc[0]), float(acc[1]), float(acc[2]), float(acc[3]),
+         float(acc[4])};
+}
+
+void spectral_sums_scalar(const float *m, const float *prev, size_t n,
+                          float floorPower, float *chunks, SpectralSums &out) {
+  double acc[5] = {};
+  spectral_sums_range(m, prev, 0, n, floorPower, chunks, acc);
+  store_spectral_sums(acc, out);
+}
+
+void signal_sums_range(const float *x, size_t begin, size_t end,
+                       double &squares, float &peak, uint32_t &crossings) {
+  for (size_t i = begin; i < end; ++i) {
+    squares += x[i] * x[i];
+    peak = std::max(peak, std::abs(x[i]));
+    if (i > 0 && std::signbit(x[i]) != std::signbit(x[i - 1]))
+      ++crossings;
+  }
+}
+
+void signal_sums_scalar(const float *x, size_t n, SignalSums &out) {
+  double squares = 0.0;
+  float peak = 0.0f;
+  uint32_t crossings = 0;
+  signal_sums_range(x, 0, n, squares, peak, crossings);
+  out = {float(squares), peak, crossings};
+}
+
+// Compare-exchange pairs of the median-of-9 network (Paeth, in Graphics
+// Gems); after them the median is element 4. The vector versions run the
+// same steps with min/max on whole registers.
+constexpr int MEDIAN9_NETWORK[19][2] = {
+    {1, 2}, {4, 5}, {7, 8}, {0, 1}, {3, 4}, {6, 7}, {1, 2},
+    {4, 5}, {7, 8}, {0, 3}, {5, 8}, {4, 7}, {3, 6}, {1, 4},
+    {2, 5}, {4, 7}, {4, 2}, {6, 4}, {4, 2}};
+
+void median9_scalar(const float *const rows[9], float *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    float p[9];
+    for (int r = 0; r < 9; ++r)
+      p[r] = rows[r][i];
+    for (const auto &[a, b] : MEDIAN9_NETWORK) {
+      float lo = std::min(p[a], p[b]);
+      p[b] = std::max(p[a], p[b]);
+      p[a] = lo;
+    }
+    out[i] = p[4];
+  }
+}
+
+#ifdef DSP_X86
+
+// Natural log of positive normal floats: split off the exponent, fold the
+// mantissa into [sqrt(1/2), sqrt(2)) and evaluate the Cephes logf
+// polynomial. All three vector widths below follow the same steps.
+constexpr float LOG_P[9] = {7.0376836292e-2f,  -1.1514610310e-1f,
+                            1.1676998740e-1f,  -1.2420140846e-1f,
+                            1.4249322787e-1f,  -1.6668057665e-1f,
+                            2.0000714765e-1f,  -2.4999993993e-1f,
+                            3.3333331174e-1f};
+constexpr float SQRT_HALF = 0.707106781186547524f;
+constexpr float LN2 = 0.693147180559945309f;
+
+// exp(x) as 2^n * exp(r) with |r| <= ln(2)/2, ln(2) split in two parts
+// for an exact reduction, and the Cephes expf polynomial for exp(r).
+constexpr float EXP_P[6] = {1.9875691500e-4f, 1.3981999507e-3f,
+                            8.3334519073e-3f, 4.1665795894e-2f,
+                            1.6666665459e-1f, 5.0000001201e-1f};
+constexpr float LOG2E = 1.44269504088896341f;
+constexpr float LN2_HI = 0.693359375f;
+constexpr float LN2_LO = -2.12194440e-4f;
+constexpr float EXP_MAX = 88.3762626647949f;
+constexpr float EXP_MIN = -87.3365447504f; // smallest normal result
+
+// ---------------------------------------------------------------------------
+// SSE2
+
+__attribute__((target("sse2"))) inline __m128 log_sse2(__m128 x) {
+  __m128i bits = _mm_castps_si128(x);
+  __m128 e = _mm_cvtepi32_ps(
+      _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+  __m128 m = _mm_castsi128_ps(_mm_or_si128(
+      _mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+      _mm_set1_epi32(0x3f000000))); // [0.5, 1)
+  __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(SQRT_HALF));
+  e = _mm_sub_ps(e, _mm_and_ps(small, _mm_set1_ps(1.0f)));
+  m = _mm_add_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_and_ps(small, m));
+  __m128 z = _mm_mul_ps(m, m);
+  __m128 y = _mm_set1_ps(LOG_P[0]);
+  for (int k = 1; k < 9; ++k)
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P[k]));
+  y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+  y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(LN2)));
+}
+
+__attribute__((target("sse2"))) inline __m128 exp_sse2(__m128 x) {
+  x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_MIN)), _mm_set1_ps(EXP_MAX));
+  // floor(x * log2(e) + 0.5) without SSE4.1 rounding
+  __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(LOG2E)), _mm_set1_ps(0.5f));
+  __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  fx = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, fx), _mm_set1_ps(1.0f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(LN2_HI)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(LN2_LO)));
+  __m128 y = _mm_set1_ps(EXP_P[0]);
+  for (int k = 1; k < 6; ++k)
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P[k]));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x),
+                 _mm_set1_ps(1.0f));
+  __m128i n = _mm_slli_epi32(
+      _mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+// Squared magnitudes of 4 interleaved complex values.
+__attribute__((target("sse2"))) inline __m128 power_sse2(const float *c) {
+  __m128 a = _mm_loadu_ps(c);     // r0 i0 r1 i1
+  __m128 b = _mm_loadu_ps(c + 4); // r2 i2 r3 i3
+  __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+}
+
+__attribute__((target("sse2"))) void
+window_multiply_sse2(const float *in, const float *window, float *out,
+                     size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(window + i));
+    __m128 b =
+        _mm_mul_ps(_mm_loadu_ps(in + i + 4), _mm_loadu_ps(window + i + 4));
+    _mm_storeu_ps(out + i, a);
+    _mm_storeu_ps(out + i + 4, b);
+  }
+  window_multiply_scalar(in + i, window + i, out + i, n - i);
+}
+
+__attribute__((target("sse2"))) void
+complex_magnitude_sse2(const float *c, float *out, size_t n, float scale) {
+  size_t i = 0;
+  __m128 s = _mm_set1_ps(scale);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i, _mm_mul_ps(s, _mm_sqrt_ps(power_sse2(c + 2 * i))));
+  complex_magnitude_scalar(c + 2 * i, out + i, n - i, scale);
+}
+
+__attribute__((target("sse2"))) void
+complex_power_sse2(const float *c, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i, power_sse2(c + 2 * i));
+  complex_power_scalar(c + 2 * i, out + i, n - i);
+}
+
+__attribute__((target("sse2"))) void
+complex_db_sse2(const float *c, float *out, size_t n, float floorPower) {
+  size_t i = 0;
+  __m128 lo = _mm_set1_ps(floorPower);
+  __m128 k = _mm_set1_ps(DB_PER_LN);
+  for (; i + 4 <= n; i += 4) {
+    __m128 p = _mm_max_ps(power_sse2(c + 2 * i), lo);
+    _mm_storeu_ps(out + i, _mm_mul_ps(k, log_sse2(p)));
+  }
+  complex_db_scalar(c + 2 * i, out + i, n - i, floorPower);
+}
+
+__attribute__((target("sse2"))) void
+pow_positive_sse2(const float *in, float *out, size_t n, float exponent) {
+  size_t i = 0;
+  __m128 e = _mm_set1_ps(exponent);
+  __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(in + i);
+    __m128 y = exp_sse2(_mm_mul_ps(e, log_sse2(x)));
+    _mm_storeu_ps(out + i, _mm_and_ps(_mm_cmpgt_ps(x, zero), y));
+  }
+  pow_positive_scalar(in + i, out + i, n - i, exponent);
+}
+
+__attribute__((target("sse2"))) float sum_sse2(const float *x, size_t n) {
+  size_t i = 0;
+  __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    a = _mm_add_ps(a, _mm_loadu_ps(x + i));
+    b = _mm_add_ps(b, _mm_loadu_ps(x + i + 4));
+  }
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, _mm_add_ps(a, b));
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+         sum_scalar(x + i, n - i);
+}
+
+// Per row: one accumulator of x * c, whose lane sum is the real part, and
+// one of x * swap(c), whose odd minus even lanes give the imaginary part.
+__attribute__((target("sse2"))) void
+sparse_matvec_magnitude_sse2(const float *x, const SparseBand *rows,
+                             size_t numRows, const float *coeffs,
+                             float *out) {
+  const __m128 sign = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + 2 * rows[r].start;
+    const float *c = coeffs + 2 * rows[r].offset;
+    const uint32_t n = rows[r].length;
+    __m128 accRe = _mm_setzero_ps(), accIm = _mm_setzero_ps();
+    uint32_t j = 0;
+    for (; j + 2 <= n; j += 2) {
+      __m128 va = _mm_loadu_ps(a + 2 * j);
+      __m128 vc = _mm_loadu_ps(c + 2 * j);
+      accRe = _mm_add_ps(accRe, _mm_mul_ps(va, vc));
+      accIm = _mm_add_ps(
+          accIm,
+          _mm_mul_ps(va, _mm_shuffle_ps(vc, vc, _MM_SHUFFLE(2, 3, 0, 1))));
+    }
+    alignas(16) float re4[4], im4[4];
+    _mm_store_ps(re4, accRe);
+    _mm_store_ps(im4, _mm_mul_ps(accIm, sign));
+    float re = (re4[0] + re4[1]) + (re4[2] + re4[3]);
+    float im = (im4[0] + im4[1]) + (im4[2] + im4[3]);
+    for (; j < n; ++j) {
+      re += a[2 * j] * c[2 * j] + a[2 * j + 1] * c[2 * j + 1];
+      im += a[2 * j + 1] * c[2 * j] - a[2 * j] * c[2 * j + 1];
+    }
+    out[r] = std::sqrt(re * re + im * im);
+  }
+}
+
+__attribute__((target("sse2"))) void
+sparse_matvec_sse2(const float *x, const SparseBand *rows, size_t numRows,
+                   const float *weights, float *out) {
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + rows[r].start;
+    const float *w = weights + rows[r].offset;
+    const uint32_t n = rows[r].length;
+    __m128 acc = _mm_setzero_ps();
+    uint32_t j = 0;
+    for (; j + 4 <= n; j += 4)
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(w + j)));
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; j < n; ++j)
+      sum += a[j] * w[j];
+    out[r] = sum;
+  }
+}
+
+__attribute__((target("sse2"))) void
+power_db_sse2(const float *p, float *out, size_t n, float floorPower) {
+  size_t i = 0;
+  __m128 lo = _mm_set1_ps(floorPower);
+  __m128 k = _mm_set1_ps(DB_PER_LN);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i,
+                  _mm_mul_ps(k, log_sse2(_mm_max_ps(_mm_loadu_ps(p + i), lo))));
+  power_db_scalar(p + i, out + i, n - i, floorPower);
+}
+
+// Four bands per pass, one per lane; the cascade state stays in registers
+// for the whole block.
+__attribute__((target("sse2"))) void
+biquad_bank_envelope_sse2(const float *in, size_t n, const float *coeffs,
+                          float *state, int stages, int bands,
+                          const float *follower, float *envelope) {
+  constexpr int MAX_STAGES = 8;
+  if (stages > MAX_STAGES) {
+    biquad_bank_envelope_scalar(in, n, coeffs, state, stages, bands, follower,
+                                envelope);
+    return;
+  }
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  for (int b = 0; b < bands; b += 4) {
+    __m128 c[MAX_STAGES][5], z1[MAX_STAGES], z2[MAX_STAGES];
+    for (int s = 0; s < stages; ++s) {
+      for (int k = 0; k < 5; ++k)
+        c[s][k] = _mm_loadu_ps(coeffs + (5 * s + k) * bands + b);
+      z1[s] = _mm_loadu_ps(state + 2 * s * bands + b);
+      z2[s] = _mm_loadu_ps(state + (2 * s + 1) * bands + b);
+    }
+    const __m128 attack = _mm_loadu_ps(follower + b);
+    const __m128 release = _mm_loadu_ps(follower + bands + b);
+    __m128 e = _mm_loadu_ps(envelope + b);
+    for (size_t i = 0; i < n; ++i) {
+      __m128 x = _mm_set1_ps(in[i]);
+      for (int s = 0; s < stages; ++s) {
+        __m128 y = _mm_add_ps(_mm_mul_ps(c[s][0], x), z1[s]);
+        z1[s] = _mm_add_ps(
+            _mm_sub_ps(_mm_mul_ps(c[s][1], x), _mm_mul_ps(c[s][3], y)), z2[s]);
+        z2[s] = _mm_sub_ps(_mm_mul_ps(c[s][2], x), _mm_mul_ps(c[s][4], y));
+        x = y;
+      }
+      __m128 a = _mm_and_ps(x, absMask);
+      __m128 rising = _mm_cmpgt_ps(a, e);
+      __m128 k = _mm_or_ps(_mm_and_ps(rising, attack),
+                           _mm_andnot_ps(rising, release));
+      e = _mm_add_ps(e, _mm_mul_ps(k, _mm_sub_ps(a, e)));
+    }
+    for (int s = 0; s < stages; ++s) {
+      _mm_storeu_ps(state + 2 * s * bands + b, z1[s]);
+      _mm_storeu_ps(state + (2 * s + 1) * bands + b, z2[s]);
+    }
+    _mm_storeu_ps(envelope + b, e);
+  }
+}
+
+__attribute__((target("sse2"))) inline float hsum_sse2(__m128 v) {
+  v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+  return _mm_cvtss_f32(v);
+}
+
+// One chunk of 16 bins per iteration, four vectors of four.
+__attribute__((target("sse2"))) void
+spectral_sums_sse2(const float *m, const float *prev, size_t n,
+                   float floorPower, float *chunks, SpectralSums &out) {
+  const __m128 lo = _mm_set1_ps(floorPower);
+  const __m128 four = _mm_set1_ps(4.0f);
+  const __m128 zero = _mm_setzero_ps();
+  __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  __m128 weighted = zero, power = zero, logPower = zero, flux = zero;
+  double acc[5] = {};
+  size_t i = 0;
+  for (; i + SPECTRAL_CHUNK <= n; i += SPECTRAL_CHUNK) {
+    __m128 chunk = zero;
+    for (size_t k = 0; k < SPECTRAL_CHUNK; k += 4) {
+      __m128 v = _mm_loadu_ps(m + i + k);
+      __m128 p = _mm_mul_ps(v, v);
+      chunk = _mm_add_ps(chunk, v);
+      weighted = _mm_add_ps(weighted, _mm_mul_ps(index, v));
+      index = _mm_add_ps(index, four);
+      power = _mm_add_ps(power, p);
+      logPower = _mm_add_ps(logPower, log_sse2(_mm_max_ps(p, lo)));
+      flux = _mm_add_ps(
+          flux, _mm_max_ps(_mm_sub_ps(v, _mm_loadu_ps(prev + i + k)), zero));
+    }
+    chunks[i / SPECTRAL_CHUNK] = hsum_sse2(chunk);
+    acc[0] += chunks[i / SPECTRAL_CHUNK];
+  }
+  acc[1] = hsum_sse2(weighted);
+  acc[2] = hsum_sse2(power);
+  acc[3] = hsum_sse2(logPower);
+  acc[4] = hsum_sse2(flux);
+  spectral_sums_range(m, prev, i, n, floorPower, chunks, acc);
+  store_spectral_sums(acc, out);
+}
+
+// Sign changes are the sign bits of x[i] ^ x[i - 1], from an unaligned
+// load one sample back.
+__attribute__((target("sse2"))) void
+signal_sums_sse2(const float *x, size_t n, SignalSums &out) {
+  double squares = 0.0;
+  float peak = 0.0f;
+  uint32_t crossings = 0;
+  signal_sums_range(x, 0, std::min<size_t>(n, 1), squares, peak, crossings);
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 sq = _mm_setzero_ps(), pk = _mm_setzero_ps();
+  size_t i = 1;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(x + i);
+    sq = _mm_add_ps(sq, _mm_mul_ps(v, v));
+    pk = _mm_max_ps(pk, _mm_and_ps(v, absMask));
+    crossings += __builtin_popcount(
+        _mm_movemask_ps(_mm_xor_ps(v, _mm_loadu_ps(x + i - 1))));
+  }
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, pk);
+  peak = std::max({peak, lanes[0], lanes[1], lanes[2], lanes[3]});
+  squares += hsum_sse2(sq);
+  signal_sums_range(x, std::min(i, n), n, squares, peak, crossings);
+  out = {float(squares), peak, crossings};
+}
+
+__attribute__((target("sse2"))) void
+median9_sse2(const float *const rows[9], float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 p[9];
+    for (int r = 0; r < 9; ++r)
+      p[r] = _mm_loadu_ps(rows[r] + i);
+    for (const auto &[a, b] : MEDIAN9_NETWORK) {
+      __m128 lo = _mm_min_ps(p[a], p[b]);
+      p[b] = _mm_max_ps(p[a], p[b]);
+      p[a] = lo;
+    }
+    _mm_storeu_ps(out + i, p[4]);
+  }
+  const float *tail[9];
+  for (int r = 0; r < 9; ++r)
+    tail[r] = rows[r] + i;
+  median9_scalar(tail, out + i, n - i);
+}
+
+__attribute__((target("sse2"))) void
+pcm16_to_float_sse2(const void *in, float *out, size_t n) {
+  const int16_t *p = static_cast<const int16_t *>(in);
+  const __m128 k = _mm_set1_ps(PCM16_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    // Interleave with itself and shift back down to sign-extend.
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+  }
+  pcm16_to_float_scalar(p + i, out + i, n - i);
+}
+
+__attribute__((target("sse2"))) void
+pcm32_to_float_sse2(const void *in, float *out, size_t n) {
+  const int32_t *p = static_cast<const int32_t *>(in);
+  const __m128 k = _mm_set1_ps(PCM32_SCALE);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), k));
+  }
+  pcm32_to_float_scalar(p + i, out + i, n - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2
+
+__attribute__((target("avx2,fma"))) inline __m256 log_avx2(__m256 x) {
+  __m256i bits = _mm256_castps_si256(x);
+  __m256 e = _mm256_cvtepi32_ps(
+      _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+  __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+      _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+      _mm256_set1_epi32(0x3f000000)));
+  __m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(SQRT_HALF), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(small, _mm256_set1_ps(1.0f)));
+  m = _mm256_add_ps(_mm256_sub_ps(m, _mm256_set1_ps(1.0f)),
+                    _mm256_and_ps(small, m));
+  __m256 z = _mm256_mul_ps(m, m);
+  __m256 y = _mm256_set1_ps(LOG_P[0]);
+  for (int k = 1; k < 9; ++k)
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P[k]));
+  y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+  y = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), y);
+  return _mm256_fmadd_ps(e, _mm256_set1_ps(LN2), _mm256_add_ps(m, y));
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 exp_avx2(__m256 x) {
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)),
+                    _mm256_set1_ps(EXP_MAX));
+  __m256 fx = _mm256_floor_ps(
+      _mm256_fmadd_ps(x, _mm256_set1_ps(LOG2E), _mm256_set1_ps(0.5f)));
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(LN2_HI), x);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(LN2_LO), x);
+  __m256 y = _mm256_set1_ps(EXP_P[0]);
+  for (int k = 1; k < 6; ++k)
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P[k]));
+  y = _mm256_add_ps(_mm256_fmadd_ps(y, _mm256_mul_ps(x, x), x),
+                    _mm256_set1_ps(1.0f));
+  __m256i n = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(fx), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(n));
+}
+
+__attribute__((target("avx2,fma"))) inline float hsum_avx2(__m256 v) {
+  __m128 q = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  q = _mm_add_ps(q, _mm_movehl_ps(q, q));
+  q = _mm_add_ss(q, _mm_shuffle_ps(q, q, 1));
+  return _mm_cvtss_f32(q);
+}
+
+// Squared magnitudes of 8 interleaved complex values, in order.
+__attribute__((target("avx2,fma"))) inline __m256 power_avx2(const float *c) {
+  __m256 a = _mm256_loadu_ps(c);     // r0 i0 r1 i1 | r2 i2 r3 i3
+  __m256 b = _mm256_loadu_ps(c + 8); // r4 i4 r5 i5 | r6 i6 r7 i7
+  __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+  __m256 p = _mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im));
+  // Lanes are r0 r1 r4 r5 | r2 r3 r6 r7; restore sequential order.
+  return _mm256_castpd_ps(
+      _mm256_permute4x64_pd(_mm256_castps_pd(p), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__attribute__((target("avx2,fma"))) void
+window_multiply_avx2(const float *in, const float *window, float *out,
+                     size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i),
+                                            _mm256_loadu_ps(window + i)));
+  window_multiply_scalar(in + i, window + i, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void
+complex_magnitude_avx2(const float *c, float *out, size_t n, float scale) {
+  size_t i = 0;
+  __m256 s = _mm256_set1_ps(scale);
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i,
+                     _mm256_mul_ps(s, _mm256_sqrt_ps(power_avx2(c + 2 * i))));
+  complex_magnitude_scalar(c + 2 * i, out + i, n - i, scale);
+}
+
+__attribute__((target("avx2,fma"))) void
+complex_power_avx2(const float *c, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, power_avx2(c + 2 * i));
+  complex_power_scalar(c + 2 * i, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void
+complex_db_avx2(const float *c, float *out, size_t n, float floorPower) {
+  size_t i = 0;
+  __m256 lo = _mm256_set1_ps(floorPower);
+  __m256 k = _mm256_set1_ps(DB_PER_LN);
+  for (; i + 8 <= n; i += 8) {
+    __m256 p = _mm256_max_ps(power_avx2(c + 2 * i), lo);
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(k, log_avx2(p)));
+  }
+  complex_db_scalar(c + 2 * i, out + i, n - i, floorPower);
+}
+
+__attribute__((target("avx2,fma"))) void
+pow_positive_avx2(const float *in, float *out, size_t n, float exponent) {
+  size_t i = 0;
+  __m256 e = _mm256_set1_ps(exponent);
+  __m256 zero = _mm256_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(in + i);
+    __m256 y = exp_avx2(_mm256_mul_ps(e, log_avx2(x)));
+    _mm256_storeu_ps(out + i,
+                     _mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), y));
+  }
+  pow_positive_scalar(in + i, out + i, n - i, exponent);
+}
+
+__attribute__((target("avx2,fma"))) float sum_avx2(const float *x,
+                                                    size_t n) {
+  size_t i = 0;
+  __m256 a = _mm256_setzero_ps(), b = _mm256_setzero_ps();
+  __m256 c = _mm256_setzero_ps(), d = _mm256_setzero_ps();
+  for (; i + 32 <= n; i += 32) {
+    a = _mm256_add_ps(a, _mm256_loadu_ps(x + i));
+    b = _mm256_add_ps(b, _mm256_loadu_ps(x + i + 8));
+    c = _mm256_add_ps(c, _mm256_loadu_ps(x + i + 16));
+    d = _mm256_add_ps(d, _mm256_loadu_ps(x + i + 24));
+  }
+  for (; i + 8 <= n; i += 8)
+    a = _mm256_add_ps(a, _mm256_loadu_ps(x + i));
+  __m256 s = _mm256_add_ps(_mm256_add_ps(a, b), _mm256_add_ps(c, d));
+  return hsum_avx2(s) + sum_scalar(x + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void
+sparse_matvec_magnitude_avx2(const float *x, const SparseBand *rows,
+                             size_t numRows, const float *coeffs,
+                             float *out) {
+  const __m256 sign =
+      _mm256_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + 2 * rows[r].start;
+    const float *c = coeffs + 2 * rows[r].offset;
+    const uint32_t n = rows[r].length;
+    __m256 accRe = _mm256_setzero_ps(), accIm = _mm256_setzero_ps();
+    uint32_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+      __m256 va = _mm256_loadu_ps(a + 2 * j);
+      __m256 vc = _mm256_loadu_ps(c + 2 * j);
+      accRe = _mm256_fmadd_ps(va, vc, accRe);
+      accIm = _mm256_fmadd_ps(va, _mm256_permute_ps(vc, 0xb1), accIm);
+    }
+    float re = hsum_avx2(accRe);
+    float im = hsum_avx2(_mm256_mul_ps(accIm, sign));
+    for (; j < n; ++j) {
+      re += a[2 * j] * c[2 * j] + a[2 * j + 1] * c[2 * j + 1];
+      im += a[2 * j + 1] * c[2 * j] - a[2 * j] * c[2 * j + 1];
+    }
+    out[r] = std::sqrt(re * re + im * im);
+  }
+}
+
+__attribute__((target("avx2,fma"))) void
+sparse_matvec_avx2(const float *x, const SparseBand *rows, size_t numRows,
+                   const float *weights, float *out) {
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + rows[r].start;
+    const float *w = weights + rows[r].offset;
+    const uint32_t n = rows[r].length;
+    __m256 acc = _mm256_setzero_ps();
+    uint32_t j = 0;
+    for (; j + 8 <= n; j += 8)
+      acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(w + j),
+                            acc);
+    float sum = hsum_avx2(acc);
+    for (; j < n; ++j)
+      sum += a[j] * w[j];
+    out[r] = sum;
+  }
+}
+
+__attribute__((target("avx2,fma"))) void
+power_db_avx2(const float *p, float *out, size_t n, float floorPower) {
+  size_t i = 0;
+  __m256 lo = _mm256_set1_ps(floorPower);
+  __m256 k = _mm256_set1_ps(DB_PER_LN);
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(k, log_avx2(_mm256_max_ps(
+                                                   _mm256_loadu_ps(p + i), lo))));
+  power_db_scalar(p + i, out + i, n - i, floorPower);
+}
+
+// Eight bands per pass, one per lane.
+__attribute__((target("avx2,fma"))) void
+biquad_bank_envelope_avx2(const float *in, size_t n, const float *coeffs,
+                          float *state, int stages, int bands,
+                          const float *follower, float *envelope) {
+  constexpr int MAX_STAGES = 8;
+  if (stages > MAX_STAGES) {
+    biquad_bank_envelope_scalar(in, n, coeffs, state, stages, bands, follower,
+                                envelope);
+    return;
+  }
+  const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  for (int b = 0; b < bands; b += 8) {
+    __m256 c[MAX_STAGES][5], z1[MAX_STAGES], z2[MAX_STAGES];
+    for (int s = 0; s < stages; ++s) {
+      for (int k = 0; k < 5; ++k)
+        c[s][k] = _mm256_loadu_ps(coeffs + (5 * s + k) * bands + b);
+      z1[s] = _mm256_loadu_ps(state + 2 * s * bands + b);
+      z2[s] = _mm256_loadu_ps(state + (2 * s + 1) * bands + b);
+    }
+    const __m256 attack = _mm256_loadu_ps(follower + b);
+    const __m256 release = _mm256_loadu_ps(follower + bands + b);
+    __m256 e = _mm256_loadu_ps(envelope + b);
+    for (size_t i = 0; i < n; ++i) {
+      __m256 x = _mm256_set1_ps(in[i]);
+      for (int s = 0; s < stages; ++s) {
+        __m256 y = _mm256_fmadd_ps(c[s][0], x, z1[s]);
+        z1[s] = _mm256_fnmadd_ps(c[s][3], y,
+                                 _mm256_fmadd_ps(c[s][1], x, z2[s]));
+        z2[s] = _mm256_fnmadd_ps(c[s][4], y, _mm256_mul_ps(c[s][2], x));
+        x = y;
+      }
+      __m256 a = _mm256_and_ps(x, absMask);
+      __m256 k = _mm256_blendv_ps(release, attack,
+                                  _mm256_cmp_ps(a, e, _CMP_GT_OQ));
+      e = _mm256_fmadd_ps(k, _mm256_sub_ps(a, e), e);
+    }
+    for (int s = 0; s < stages; ++s) {
+      _mm256_storeu_ps(state + 2 * s * bands + b, z1[s]);
+      _mm256_storeu_ps(state + (2 * s + 1) * bands + b, z2[s]);
+    }
+    _mm256_storeu_ps(envelope + b, e);
+  }
+}
+
+__attribute__((target("avx2,fma"))) void
+spectral_sums_avx2(const float *m, const float *prev, size_t n,
+                   float floorPower, float *chunks, SpectralSums &out) {
+  const __m256 lo = _mm256_set1_ps(floorPower);
+  const __m256 eight = _mm256_set1_ps(8.0f);
+  const __m256 zero = _mm256_setzero_ps();
+  __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+  __m256 weighted = zero, power = zero, logPower = zero, flux = zero;
+  double acc[5] = {};
+  size_t i = 0;
+  for (; i + SPECTRAL_CHUNK <= n; i += SPECTRAL_CHUNK) {
+    __m256 chunk = zero;
+    for (size_t k = 0; k < SPECTRAL_CHUNK; k += 8) {
+      __m256 v = _mm256_loadu_ps(m + i + k);
+      __m256 p = _mm256_mul_ps(v, v);
+      chunk = _mm256_add_ps(chunk, v);
+      weighted = _mm256_fmadd_ps(index, v, weighted);
+      index = _mm256_add_ps(index, eight);
+      power = _mm256_add_ps(power, p);
+      logPower = _mm256_add_ps(logPower, log_avx2(_mm256_max_ps(p, lo)));
+      flux = _mm256_add_ps(
+          flux, _mm256_max_ps(_mm256_sub_ps(v, _mm256_loadu_ps(prev + i + k)),
+                              zero));
+    }
+    chunks[i / SPECTRAL_CHUNK] = hsum_avx2(chunk);
+    acc[0] += chunks[i / SPECTRAL_CHUNK];
+  }
+  acc[1] = hsum_avx2(weighted);
+  acc[2] = hsum_avx2(power);
+  acc[3] = hsum_avx2(logPower);
+  acc[4] = hsum_avx2(flux);
+  spectral_sums_range(m, prev, i, n, floorPower, chunks, acc);
+  store_spectral_sums(acc, out);
+}
+
+__attribute__((target("avx2,fma"))) void
+signal_sums_avx2(const float *x, size_t n, SignalSums &out) {
+  double squares = 0.0;
+  float peak = 0.0f;
+  uint32_t crossings = 0;
+  signal_sums_range(x, 0, std::min<size_t>(n, 1), squares, peak, crossings);
+  const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  __m256 sq = _mm256_setzero_ps(), pk = _mm256_setzero_ps();
+  size_t i = 1;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(x + i);
+    sq = _mm256_fmadd_ps(v, v, sq);
+    pk = _mm256_max_ps(pk, _mm256_and_ps(v, absMask));
+    crossings += __builtin_popcount(
+        _mm256_movemask_ps(_mm256_xor_ps(v, _mm256_loadu_ps(x + i - 1))));
+  }
+  __m128 p4 = _mm_max_ps(_mm256_castps256_ps128(pk),
+                         _mm256_extractf128_ps(pk, 1));
+  p4 = _mm_max_ps(p4, _mm_movehl_ps(p4, p4));
+  p4 = _mm_max_ss(p4, _mm_shuffle_ps(p4, p4, 1));
+  peak = std::max(peak, _mm_cvtss_f32(p4));
+  squares += hsum_avx2(sq);
+  signal_sums_range(x, std::min(i, n), n, squares, peak, crossings);
+  out = {float(squares), peak, crossings};
+}
+
+__attribute__((target("avx2,fma"))) void
+median9_avx2(const float *const rows[9], float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 p[9];
+    for (int r = 0; r < 9; ++r)
+      p[r] = _mm256_loadu_ps(rows[r] + i);
+    for (const auto &[a, b] : MEDIAN9_NETWORK) {
+      __m256 lo = _mm256_min_ps(p[a], p[b]);
+      p[b] = _mm256_max_ps(p[a], p[b]);
+      p[a] = lo;
+    }
+    _mm256_storeu_ps(out + i, p[4]);
+  }
+  const float *tail[9];
+  for (int r = 0; r < 9; ++r)
+    tail[r] = rows[r] + i;
+  median9_scalar(tail, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void
+pcm16_to_float_avx2(const void *in, float *out, size_t n) {
+  const int16_t *p = static_cast<const int16_t *>(in);
+  const __m256 k = _mm256_set1_ps(PCM16_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), k));
+  }
+  pcm16_to_float_scalar(p + i, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void
+pcm24_to_float_avx2(const void *in, float *out, size_t n) {
+  const unsigned char *p = static_cast<const unsigned char *>(in);
+  const __m256 k = _mm256_set1_ps(PCM32_SCALE);
+  // Moves each 3-byte sample into the top of a 32-bit lane, so the sign
+  // lands in bit 31 and the result is the sample scaled by 256.
+  const __m256i shuffle = _mm256_setr_epi8(
+      -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, //
+      -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  size_t i = 0;
+  // Each step loads 28 bytes for 24 bytes of samples; stop early enough
+  // that the over-read stays inside the input.
+  for (; 3 * (i + 8) + 4 <= 3 * n; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 3 * i));
+    __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 3 * i + 12));
+    __m256i v = _mm256_shuffle_epi8(
+        _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1), shuffle);
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), k));
+  }
+  pcm24_to_float_scalar(p + 3 * i, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void
+pcm32_to_float_avx2(const void *in, float *out, size_t n) {
+  const int32_t *p = static_cast<const int32_t *>(in);
+  const __m256 k = _mm256_set1_ps(PCM32_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), k));
+  }
+  pcm32_to_float_scalar(p + i, out + i, n - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512
+
+__attribute__((target("avx512f"))) inline __m512 log_avx512(__m512 x) {
+  __m512i bits = _mm512_castps_si512(x);
+  __m512 e = _mm512_cvtepi32_ps(
+      _mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+  __m512 m = _mm512_castsi512_ps(_mm512_or_si512(
+      _mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+      _mm512_set1_epi32(0x3f000000)));
+  __mmask16 small = _mm512_cmp_ps_mask(m, _mm512_set1_ps(SQRT_HALF),
+                                       _CMP_LT_OQ);
+  e = _mm512_mask_sub_ps(e, small, e, _mm512_set1_ps(1.0f));
+  m = _mm512_mask_add_ps(_mm512_sub_ps(m, _mm512_set1_ps(1.0f)), small,
+                         _mm512_sub_ps(m, _mm512_set1_ps(1.0f)), m);
+  __m512 z = _mm512_mul_ps(m, m);
+  __m512 y = _mm512_set1_ps(LOG_P[0]);
+  for (int k = 1; k < 9; ++k)
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P[k]));
+  y = _mm512_mul_ps(_mm512_mul_ps(y, m), z);
+  y = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), y);
+  return _mm512_fmadd_ps(e, _mm512_set1_ps(LN2), _mm512_add_ps(m, y));
+}
+
+__attribute__((target("avx512f"))) inline __m512 exp_avx512(__m512 x) {
+  x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_MIN)),
+                    _mm512_set1_ps(EXP_MAX));
+  __m512 fx = _mm512_roundscale_ps(
+      _mm512_fmadd_ps(x, _mm512_set1_ps(LOG2E), _mm512_set1_ps(0.5f)),
+      _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(LN2_HI), x);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(LN2_LO), x);
+  __m512 y = _mm512_set1_ps(EXP_P[0]);
+  for (int k = 1; k < 6; ++k)
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P[k]));
+  y = _mm512_add_ps(_mm512_fmadd_ps(y, _mm512_mul_ps(x, x), x),
+                    _mm512_set1_ps(1.0f));
+  return _mm512_scalef_ps(y, fx);
+}
+
+// Squared magnitudes of 16 interleaved complex values, in order.
+__attribute__((target("avx512f"))) inline __m512
+power_avx512(const float *c) {
+  __m512 a = _mm512_loadu_ps(c);
+  __m512 b = _mm512_loadu_ps(c + 16);
+  const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18,
+                                         20, 22, 24, 26, 28, 30);
+  const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19,
+                                        21, 23, 25, 27, 29, 31);
+  __m512 re = _mm512_permutex2var_ps(a, even, b);
+  __m512 im = _mm512_permutex2var_ps(a, odd, b);
+  return _mm512_fmadd_ps(re, re, _mm512_mul_ps(im, im));
+}
+
+__attribute__((target("avx512f"))) void
+window_multiply_avx512(const float *in, const float *window, float *out,
+                       size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(in + i),
+                                            _mm512_loadu_ps(window + i)));
+  window_multiply_scalar(in + i, window + i, out + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void
+complex_magnitude_avx512(const float *c, float *out, size_t n, float scale) {
+  size_t i = 0;
+  __m512 s = _mm512_set1_ps(scale);
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(
+        out + i, _mm512_mul_ps(s, _mm512_sqrt_ps(power_avx512(c + 2 * i))));
+  complex_magnitude_scalar(c + 2 * i, out + i, n - i, scale);
+}
+
+__attribute__((target("avx512f"))) void
+complex_power_avx512(const float *c, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(out + i, power_avx512(c + 2 * i));
+  complex_power_scalar(c + 2 * i, out + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void
+complex_db_avx512(const float *c, float *out, size_t n, float floorPower) {
+  size_t i = 0;
+  __m512 lo = _mm512_set1_ps(floorPower);
+  __m512 k = _mm512_set1_ps(DB_PER_LN);
+  for (; i + 16 <= n; i += 16) {
+    __m512 p = _mm512_max_ps(power_avx512(c + 2 * i), lo);
+    _mm512_storeu_ps(out + i, _mm512_mul_ps(k, log_avx512(p)));
+  }
+  complex_db_scalar(c + 2 * i, out + i, n - i, floorPower);
+}
+
+__attribute__((target("avx512f"))) void
+pow_positive_avx512(const float *in, float *out, size_t n, float exponent) {
+  size_t i = 0;
+  __m512 e = _mm512_set1_ps(exponent);
+  for (; i + 16 <= n; i += 16) {
+    __m512 x = _mm512_loadu_ps(in + i);
+    __mmask16 positive = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ);
+    _mm512_storeu_ps(out + i,
+                     _mm512_maskz_mov_ps(positive, exp_avx512(_mm512_mul_ps(
+                                                      e, log_avx512(x)))));
+  }
+  pow_positive_scalar(in + i, out + i, n - i, exponent);
+}
+
+__attribute__((target("avx512f"))) float sum_avx512(const float *x,
+                                                   size_t n) {
+  size_t i = 0;
+  __m512 a = _mm512_setzero_ps(), b = _mm512_setzero_ps();
+  for (; i + 32 <= n; i += 32) {
+    a = _mm512_add_ps(a, _mm512_loadu_ps(x + i));
+    b = _mm512_add_ps(b, _mm512_loadu_ps(x + i + 16));
+  }
+  for (; i + 16 <= n; i += 16)
+    a = _mm512_add_ps(a, _mm512_loadu_ps(x + i));
+  return _mm512_reduce_add_ps(_mm512_add_ps(a, b)) + sum_scalar(x + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void
+sparse_matvec_magnitude_avx512(const float *x, const SparseBand *rows,
+                               size_t numRows, const float *coeffs,
+                               float *out) {
+  const __m512 sign = _mm512_castsi512_ps(_mm512_set1_epi64(0x3f800000bf800000));
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + 2 * rows[r].start;
+    const float *c = coeffs + 2 * rows[r].offset;
+    const uint32_t n = rows[r].length;
+    __m512 accRe = _mm512_setzero_ps(), accIm = _mm512_setzero_ps();
+    uint32_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+      __m512 va = _mm512_loadu_ps(a + 2 * j);
+      __m512 vc = _mm512_loadu_ps(c + 2 * j);
+      accRe = _mm512_fmadd_ps(va, vc, accRe);
+      accIm = _mm512_fmadd_ps(va, _mm512_permute_ps(vc, 0xb1), accIm);
+    }
+    float re = _mm512_reduce_add_ps(accRe);
+    float im = _mm512_reduce_add_ps(_mm512_mul_ps(accIm, sign));
+    for (; j < n; ++j) {
+      re += a[2 * j] * c[2 * j] + a[2 * j + 1] * c[2 * j + 1];
+      im += a[2 * j + 1] * c[2 * j] - a[2 * j] * c[2 * j + 1];
+    }
+    out[r] = std::sqrt(re * re + im * im);
+  }
+}
+
+__attribute__((target("avx512f"))) void
+sparse_matvec_avx512(const float *x, const SparseBand *rows, size_t numRows,
+                     const float *weights, float *out) {
+  for (size_t r = 0; r < numRows; ++r) {
+    const float *a = x + rows[r].start;
+    const float *w = weights + rows[r].offset;
+    const uint32_t n = rows[r].length;
+    __m512 acc = _mm512_setzero_ps();
+    uint32_t j = 0;
+    for (; j + 16 <= n; j += 16)
+      acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(w + j),
+                            acc);
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; j < n; ++j)
+      sum += a[j] * w[j];
+    out[r] = sum;
+  }
+}
+
+__attribute__((target("avx512f"))) void
+power_db_avx512(const float *p, float *out, size_t n, float floorPower) {
+  size_t i = 0;
+  __m512 lo = _mm512_set1_ps(floorPower);
+  __m512 k = _mm512_set1_ps(DB_PER_LN);
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(out + i, _mm512_mul_ps(k, log_avx512(_mm512_max_ps(
+                                                   _mm512_loadu_ps(p + i), lo))));
+  power_db_scalar(p + i, out + i, n - i, floorPower);
+}
+
+// A chunk is exactly one vector.
+__attribute__((target("avx512f"))) void
+spectral_sums_avx512(const float *m, const float *prev, size_t n,
+                     float floorPower, float *chunks, SpectralSums &out) {
+  const __m512 lo = _mm512_set1_ps(floorPower);
+  const __m512 sixteen = _mm512_set1_ps(16.0f);
+  const __m512 zero = _mm512_setzero_ps();
+  __m512 index = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f,
+                                7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f,
+                                14.0f, 15.0f);
+  __m512 weighted = zero, power = zero, logPower = zero, flux = zero;
+  double acc[5] = {};
+  size_t i = 0;
+  for (; i + SPECTRAL_CHUNK <= n; i += SPECTRAL_CHUNK) {
+    __m512 v = _mm512_loadu_ps(m + i);
+    __m512 p = _mm512_mul_ps(v, v);
+    weighted = _mm512_fmadd_ps(index, v, weighted);
+    index = _mm512_add_ps(index, sixteen);
+    power = _mm512_add_ps(power, p);
+    logPower = _mm512_add_ps(logPower, log_avx512(_mm512_max_ps(p, lo)));
+    flux = _mm512_add_ps(
+        flux,
+        _mm512_max_ps(_mm512_sub_ps(v, _mm512_loadu_ps(prev + i)), zero));
+    chunks[i / SPECTRAL_CHUNK] = _mm512_reduce_add_ps(v);
+    acc[0] += chunks[i / SPECTRAL_CHUNK];
+  }
+  acc[1] = _mm512_reduce_add_ps(weighted);
+  acc[2] = _mm512_reduce_add_ps(power);
+  acc[3] = _mm512_reduce_add_ps(logPower);
+  acc[4] = _mm512_reduce_add_ps(flux);
+  spectral_sums_range(m, prev, i, n, floorPower, chunks, acc);
+  store_spectral_sums(acc, out);
+}
+
+__attribute__((target("avx512f"))) void
+median9_avx512(const float *const rows[9], float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 p[9];
+    for (int r = 0; r < 9; ++r)
+      p[r] = _mm512_loadu_ps(rows[r] + i);
+    for (const auto &[a, b] : MEDIAN9_NETWORK) {
+      __m512 lo = _mm512_min_ps(p[a], p[b]);
+      p[b] = _mm512_max_ps(p[a], p[b]);
+      p[a] = lo;
+    }
+    _mm512_storeu_ps(out + i, p[4]);
+  }
+  const float *tail[9];
+  for (int r = 0; r < 9; ++r)
+    tail[r] = rows[r] + i;
+  median9_scalar(tail, out + i, n - i);
+}
+
+#endif // DSP_X86
+
+constexpr DspKernels SCALAR = {
+    "scalar",              window_multiply_scalar, complex_magnitude_scalar,
+    complex_power_scalar,  complex_db_scalar,      pcm16_to_float_scalar,
+    pcm24_to_float_scalar, pcm32_to_float_scalar,  pow_positive_scalar,
+    sum_scalar,            sparse_matvec_magnitude_scalar,
+    sparse_matvec_scalar,  power_db_scalar,
+    biquad_bank_envelope_scalar,
+    spectral_sums_scalar,  signal_sums_scalar,
+    median9_scalar};
+#ifdef DSP_X86
+constexpr DspKernels SSE2 = {
+    "sse2",                window_multiply_sse2, complex_magnitude_sse2,
+    complex_power_sse2,    complex_db_sse2,      pcm16_to_float_sse2,
+    pcm24_to_float_scalar, pcm32_to_float_sse2,  pow_positive_sse2,
+    sum_sse2,              sparse_matvec_magnitude_sse2,
+    sparse_matvec_sse2,    power_db_sse2,
+    biquad_bank_envelope_sse2,
+    spectral_sums_sse2,    signal_sums_sse2,
+    median9_sse2};
+constexpr DspKernels AVX2 = {
+    "avx2",              window_multiply_avx2, complex_magnitude_avx2,
+    complex_power_avx2,  complex_db_avx2,      pcm16_to_float_avx2,
+    pcm24_to_float_avx2, pcm32_to_float_avx2,  pow_positive_avx2,
+    sum_avx2,            sparse_matvec_magnitude_avx2,
+    sparse_matvec_avx2,  power_db_avx2,
+    biquad_bank_envelope_avx2,
+    spectral_sums_avx2,  signal_sums_avx2,
+    median9_avx2};
+// Sample conversion gains nothing from 512-bit lanes at these sizes, nor
+// does a biquad bank of a handful of bands or the signal sums of one frame;
+// the AVX-512 tier reuses the AVX2 versions.
+constexpr DspKernels AVX512 = {
+    "avx512",             window_multiply_avx512, complex_magnitude_avx512,
+    complex_power_avx512, complex_db_avx512,      pcm16_to_float_avx2,
+    pcm24_to_float_avx2,  pcm32_to_float_avx2,    pow_positive_avx512,
+    sum_avx512,           sparse_matvec_magnitude_avx512,
+    sparse_matvec_avx512, power_db_avx512,
+    biquad_bank_envelope_avx2,
+    spectral_sums_avx512, signal_sums_avx2,
+    median9_avx512};
+#endif
+
+// Runs a candidate against the scalar reference on a probe signal with odd
+// length (to cover the tails) and a wide dynamic range.
+bool matches_reference(const DspKernels &k) {
+  constexpr size_t N = 1037;
+  std::vector<float> c(2 * N), w(2 * N), ref(2 * N), got(2 * N);
+  uint32_t state = 0x9e3779b9u;
+  for (size_t i = 0; i < 2 * N; ++i) {
+    state = state * 1664525u + 1013904223u;
+    float u = float(state >> 8) / float(1 << 24) - 0.5f;
+    c[i] = u * std::pow(10.0f, float(i % 13) - 6.0f);
+    w[i] = u + 0.5f;
+  }
+
+  SCALAR.window_multiply(c.data(), w.data(), ref.data(), 2 * N);
+  k.window_multiply(c.data(), w.data(), got.data(), 2 * N);
+  for (size_t i = 0; i < 2 * N; ++i)
+    if (got[i] != ref[i])
+      return false;
+
+  SCALAR.complex_power(c.data(), ref.data(), N);
+  k.complex_power(c.data(), got.data(), N);
+  for (size_t i = 0; i < N; ++i)
+    if (std::abs(got[i] - ref[i]) > 1e-6f * ref[i])
+      return false;
+
+  SCALAR.complex_magnitude(c.data(), ref.data(), N, 0.5f);
+  k.complex_magnitude(c.data(), got.data(), N, 0.5f);
+  for (size_t i = 0; i < N; ++i)
+    if (std::abs(got[i] - ref[i]) > 1e-6f * ref[i])
+      return false;
+
+  SCALAR.complex_db(c.data(), ref.data(), N, 1e-12f);
+  k.complex_db(c.data(), got.data(), N, 1e-12f);
+  for (size_t i = 0; i < N; ++i)
+    if (std::abs(got[i] - ref[i]) > 1e-4f)
+      return false;
+
+  // Wide dynamic range plus exact zeros
+  for (size_t i = 0; i < N; ++i)
+    w[i] = i % 29 == 0 ? 0.0f : std::abs(c[i]);
+  for (float exponent : {0.3f, 2.2f}) {
+    SCALAR.pow_positive(w.data(), ref.data(), N, exponent);
+    k.pow_positive(w.data(), got.data(), N, exponent);
+    for (size_t i = 0; i < N; ++i)
+      if (std::abs(got[i] - ref[i]) > 1e-5f * ref[i])
+        return false;
+  }
+
+  for (size_t n : {N, size_t(5), size_t(40)}) {
+    float expect = SCALAR.sum(w.data(), n);
+    if (std::abs(k.sum(w.data(), n) - expect) > 1e-5f * expect)
+      return false;
+  }
+
+  // Rows of assorted lengths, including empty and odd ones
+  std::vector<SparseBand> rows;
+  for (uint32_t r = 0, offset = 0; r < 40; ++r) {
+    uint32_t length = (r * 7) % 23;
+    rows.push_back({r * 11 % 300, length, offset});
+    offset += length;
+  }
+  SCALAR.sparse_matvec_magnitude(c.data(), rows.data(), rows.size(),
+                                 c.data() + 700, ref.data());
+  k.sparse_matvec_magnitude(c.data(), rows.data(), rows.size(),
+                            c.data() + 700, got.data());
+  for (size_t r = 0; r < rows.size(); ++r)
+    if (std::abs(got[r] - ref[r]) > 1e-4f * (ref[r] + 1e-3f))
+      return false;
+
+  SCALAR.sparse_matvec(c.data(), rows.data(), rows.size(), c.data() + 700,
+                       ref.data());
+  k.sparse_matvec(c.data(), rows.data(), rows.size(), c.data() + 700,
+                  got.data());
+  for (size_t r = 0; r < rows.size(); ++r)
+    if (std::abs(got[r] - ref[r]) > 1e-4f * (std::abs(ref[r]) + 1e-3f))
+      return false;
+
+  SCALAR.power_db(w.data(), ref.data(), N, 1e-12f);
+  k.power_db(w.data(), got.data(), N, 1e-12f);
+  for (size_t i = 0; i < N; ++i)
+    if (std::abs(got[i] - ref[i]) > 1e-4f)
+      return false;
+
+  // Sixteen resonant bands of four stages each over a 300-sample block.
+  // The recursion amplifies FMA rounding differences a little, hence the
+  // looser bound.
+  {
+    constexpr int BANDS = 16, STAGES = 4;
+    std::vector<float> coeffs(5 * STAGES * BANDS), follower(2 * BANDS);
+    std::vector<float> stateRef(2 * STAGES * BANDS, 0.0f), stateGot;
+    std::vector<float> envRef(BANDS, 0.0f), envGot;
+    for (int s = 0; s < STAGES; ++s)
+      for (int b = 0; b < BANDS; ++b) {
+        // Two-pole resonator at radius 0.99, angle spread over the bands
+        float w = 0.05f + 0.15f * b, r = 0.99f;
+        float *row = &coeffs[5 * s * BANDS + b];
+        row[0] = 1.0f - r;
+        row[BANDS] = 0.0f;
+        row[2 * BANDS] = -(1.0f - r);
+        row[3 * BANDS] = -2.0f * r * std::cos(w);
+        row[4 * BANDS] = r * r;
+      }
+    for (int b = 0; b < BANDS; ++b) {
+      follower[b] = 0.5f;
+      follower[BANDS + b] = 0.01f;
+    }
+    stateGot = stateRef;
+    envGot = envRef;
+    SCALAR.biquad_bank_envelope(c.data(), 300, coeffs.data(), stateRef.data(),
+                                STAGES, BANDS, follower.data(), envRef.data());
+    k.biquad_bank_envelope(c.data(), 300, coeffs.data(), stateGot.data(),
+                           STAGES, BANDS, follower.data(), envGot.data());
+    for (int b = 0; b < BANDS; ++b)
+      if (std::abs(envGot[b] - envRef[b]) > 1e-3f * (envRef[b] + 1e-6f))
+        return false;
+  }
+
+  // Magnitudes against a shifted copy as the previous frame, over a length
+  // that leaves a partial chunk. The float accumulators of the vector
+  // versions drift from the double ones by a few ulps per lane add.
+  {
+    const size_t n = N - 3;
+    std::vector<float> chunksRef(n / SPECTRAL_CHUNK + 1);
+    std::vector<float> chunksGot(chunksRef.size());
+    SpectralSums sumsRef, sumsGot;
+    SCALAR.spectral_sums(w.data(), w.data() + 3, n, 1e-12f, chunksRef.data(),
+                         sumsRef);
+    k.spectral_sums(w.data(), w.data() + 3, n, 1e-12f, chunksGot.data(),
+                    sumsGot);
+    for (size_t j = 0; j < chunksRef.size(); ++j)
+      if (std::abs(chunksGot[j] - chunksRef[j]) > 1e-5f * chunksRef[j])
+        return false;
+    const float refs[] = {sumsRef.magnitude, sumsRef.weighted, sumsRef.power,
+                          sumsRef.log_power, sumsRef.flux};
+    const float gots[] = {sumsGot.magnitude, sumsGot.weighted, sumsGot.power,
+                          sumsGot.log_power, sumsGot.flux};
+    for (int f = 0; f < 5; ++f)
+      if (std::abs(gots[f] - refs[f]) > 1e-4f * std::abs(refs[f]))
+        return false;
+
+    // Signed input with exact and negative zeros for the crossings
+    for (size_t i = 0; i < N; ++i)
+      w[i] = i % 31 == 0 ? (i % 2 ? -0.0f : 0.0f) : c[i];
+    for (size_t len : {N, size_t(1), size_t(9)}) {
+      SignalSums signalRef, signalGot;
+      SCALAR.signal_sums(w.data(), len, signalRef);
+      k.signal_sums(w.data(), len, signalGot);
+      if (signalGot.crossings != signalRef.crossings ||
+          signalGot.peak != signalRef.peak ||
+          std::abs(signalGot.squares - signalRef.squares) >
+              1e-5f * signalRef.squares)
+        return false;
+    }
+  }
+
+  // Nine shifted views of the probe, as for a median along one array; the
+  // network only moves values, so results must match exactly.
+  {
+    const float *rows[9];
+    for (int r = 0; r < 9; ++r)
+      rows[r] = c.data() + r;
+    SCALAR.median9(rows, ref.data(), N);
+    k.median9(rows, got.data(), N);
+    if (std::memcmp(ref.data(), got.data(), N * sizeof(float)) != 0)
+      return false;
+  }
+
+  // Reuse the probe's bits as PCM bytes.
+  const void *pcm = c.data();
+  using Convert = void (*)(const void *, float *, size_t);
+  const Convert refs[] = {SCALAR.pcm16_to_float, SCALAR.pcm24_to_float,
+                          SCALAR.pcm32_to_float};
+  const Convert cands[] = {k.pcm16_to_float, k.pcm24_to_float,
+                           k.pcm32_to_float};
+  for (int f = 0; f < 3; ++f) {
+    refs[f](pcm, ref.data(), N);
+    cands[f](pcm, got.data(), N);
+    if (std::memcmp(ref.data(), got.data(), N * sizeof(float)) != 0)
+      return false;
+  }
+  return true;
+}
+
+const DspKernels &select_kernels() {
+  std::string cap;
+  if (const char *env = std::getenv("PIGEON_DSP_ISA"))
+    cap = env;
+
+  std::vector<const DspKernels *> candidates;
+#ifdef DSP_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma"))
+    candidates.push_back(&AVX512);
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    candidates.push_back(&AVX2);
+  if (__builtin_cpu_supports("sse2"))
+    candidates.push_back(&SSE2);
+#endif
+  auto first = candidates.begin();
+  if (!cap.empty())
+    first = std::find_if(candidates.begin(), candidates.end(),
+                         [&](const DspKernels *k) { return cap == k->isa; });
+
+  for (auto it = first; it != candidates.end(); ++it) {
+    if (matches_reference(**it)) {
+      std::cout << "[dsp] Using " << (*it)->isa << " kernels\n";
+      return **it;
+    }
+    std::cerr << "[dsp] " << (*it)->isa
+              << " kernels disagree with the scalar reference, skipping\n";
+  }
+  std::cout << "[dsp] Using scalar kernels\n";
+  return SCALAR;
+}
+
+const DspKernels &kernels() {
+  static const DspKernels &selected = select_kernels();
+  return selected;
+}
+
+} // namespace
+
+void window_multiply(const float *in, const float *window, float *out,
+                     size_t n) {
+  kernels().window_multiply(in, window, out, n);
+}
+
+void complex_magnitude(const float *c, float *out, size_t n, float scale) {
+  kernels().complex_magnitude(c, out, n, scale);
+}
+
+void complex_power(const float *c, float *out, size_t n) {
+  kernels().complex_power(c, out, n);
+}
+
+void complex_db(const float *c, float *out, size_t n, float floorPower) {
+  kernels().complex_db(c, out, n, floorPower);
+}
+
+const char *dsp_kernel_isa() { return kernels().isa; }
+
+void pcm16_to_float(const void *in, float *out, size_t n) {
+  kernels().pcm16_to_float(in, out, n);
+}
+
+void pcm24_to_float(const void *in, float *out, size_t n) {
+  kernels().pcm24_to_float(in, out, n);
+}
+
+void pcm32_to_float(const void *in, float *out, size_t n) {
+  kernels().pcm32_to_float(in, out, n);
+}
+
+void pow_positive(const float *in, float *out, size_t n, float exponent) {
+  kernels().pow_positive(in, out, n, exponent);
+}
+
+float array_sum(const float *x, size_t n) {
+  return kernels().sum(x, n);
+}
+
+void sparse_matvec_magnitude(const float *x, const SparseBand *rows,
+                             size_t numRows, const float *coeffs, float *out) {
+  kernels().sparse_matvec_magnitude(x, rows, numRows, coeffs, out);
+}
+
+void sparse_matvec(const float *x, const SparseBand *rows, size_t numRows,
+                   const float *weights, float *out) {
+  kernels().sparse_matvec(x, rows, numRows, weights, out);
+}
+
+void power_db(const float *p, float *out, size_t n, float floorPower) {
+  kernels().power_db(p, out, n, floorPower);
+}
+
+void biquad_bank_envelope(const float *in, size_t n, const float *coeffs,
+                          float *state, int stages, int bands,
+                          const float *follower, float *envelope) {
+  kernels().biquad_bank_envelope(in, n, coeffs, state, stages, bands, follower,
+                                 envelope);
+}
+
+void spectral_sums(const float *magnitudes, const float *previous, size_t n,
+                   float floorPower, float *chunks, SpectralSums &out) {
+  kernels().spectral_sums(magnitudes, previous, n, floorPower, chunks, out);
+}
+
+void signal_sums(const float *x, size_t n, SignalSums &out) {
+  kernels().signal_sums(x, n, out);
+}
+
+void median9(const float *const rows[9], float *out, size_t n) {
+  kernels().median9(rows, out, n);
+}
@@ -0,0 +1,101 @@
+#include "fft_plans.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+static bool patient_planning = false;
+static bool wisdom_dirty = false;
+
+// Identifies the CPU and FFTW build the wisdom was measured on.
+static std::string wisdom_key() {
+  std::string model = "unknown";
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.rfind("model name", 0) == 0) {
+      model = line.substr(line.find(':') + 1);
+      break;
+    }
+  }
+  size_t hash = std::hash<std::string>{}(model + '|' + fftwf_version + '|' +
+                                         fftwf_cc);
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016zx", hash);
+  return buf;
+}
+
+std::string fft_wisdom_path() {
+  std::filesystem::path dir;
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    dir = xdg;
+  else if (const char *home = std::getenv("HOME"); home && *home)
+    dir = std::filesystem::path(home) / ".cache";
+  else
+    return {};
+  return (dir / "pigeon-audio" / ("fftwf-wisdom-" + wisdom_key())).string();
+}
+
+bool load_fft_wisdom() {
+  std::string path = fft_wisdom_path();
+  if (path.empty() || !std::filesystem::exists(path))
+    return false;
+  if (!fftwf_import_wisdom_from_filename(path.c_str())) {
+    std::cerr << "[fft] Ignoring unreadable wisdom file " << path << '\n';
+    fftwf_forget_wisdom();
+    return false;
+  }
+  return true;
+}
+
+void save_fft_wisdom() {
+  if (!wisdom_dirty)
+    return;
+  std::string path = fft_wisdom_path();
+  if (path.empty())
+    return;
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), ec);
+  if (ec || !fftwf_export_wisdom_to_filename(path.c_str())) {
+    std::cerr << "[fft] Could not write wisdom to " << path << '\n';
+    return;
+  }
+  wisdom_dirty = false;
+}
+
+void set_fft_patient_planning(bool patient) { patient_planning = patient; }
+
+// Tries to build the plan from imported wisdom alone; if the cache has no
+// entry for it (new size, stale file) the plan is measured and the cache
+// marked for rewriting.
+static fftwf_plan plan_with_wisdom(
+    const std::function<fftwf_plan(unsigned)> &make) {
+  unsigned rigor = patient_planning ? FFTW_PATIENT : FFTW_MEASURE;
+  if (fftwf_plan plan = make(rigor | FFTW_WISDOM_ONLY))
+    return plan;
+  wisdom_dirty = true;
+  return make(rigor);
+}
+
+fftwf_plan plan_fft_r2c(int n, float *in, fftwf_complex *out) {
+  return plan_with_wisdom([&](unsigned flags) {
+    return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+  });
+}
+
+fftwf_plan plan_fft_c2r(int n, fftwf_complex *in, float *out) {
+  return plan_with_wisdom([&](unsigned flags) {
+    return fftwf_plan_dft_c2r_1d(n, in, out, flags);
+  });
+}
+
+fftwf_plan plan_fft_many_r2c(int n, int howmany, float *in,
+                             fftwf_complex *out) {
+  return plan_with_wisdom([&](unsigned flags) {
+    return fftwf_plan_many_dft_r2c(1, &n, howmany, in, nullptr, 1, n, out,
+                                   nullptr, 1, n / 2 + 1, flags);
+  });
+}
@@ -0,0 +1,56 @@
+#include "hpss.h"
+#include "dsp_kernels.h"
+#include <algorithm>
+
+namespace {
+constexpr float FLOOR_POWER = 1e-12f; // splits silent bins evenly
+} // namespace
+
+static_assert(HarmonicPercussiveSeparator::HISTORY == 9 &&
+                  HarmonicPercussiveSeparator::WIDTH == 9,
+              "both medians use the median9 kernel");
+
+void HarmonicPercussiveSeparator::configure(int bins) {
+  history.assign(size_t(HISTORY) * bins, 0.0f);
+  newest = 0;
+  padded.assign(bins + WIDTH - 1, 0.0f);
+  alongTime.assign(bins, 0.0f);
+  alongFrequency.assign(bins, 0.0f);
+  percussiveFraction = 0.0f;
+}
+
+void HarmonicPercussiveSeparator::process(std::span<const float> magnitudes,
+                                          std::span<float> harmonic,
+                                          std::span<float> percussive) {
+  const int bins = this->bins();
+  const float *m = magnitudes.data();
+  newest = (newest + 1) % HISTORY;
+  std::copy_n(m, bins, &history[size_t(newest) * bins]);
+
+  // The median ignores the order of its inputs, so the ring needs no
+  // unrolling.
+  const float *rows[9];
+  for (int r = 0; r < HISTORY; ++r)
+    rows[r] = &history[size_t(r) * bins];
+  median9(rows, alongTime.data(), bins);
+
+  const int half = WIDTH / 2;
+  std::fill_n(padded.begin(), half, m[0]);
+  std::copy_n(m, bins, padded.begin() + half);
+  std::fill_n(padded.begin() + half + bins, half, m[bins - 1]);
+  for (int r = 0; r < WIDTH; ++r)
+    rows[r] = padded.data() + r;
+  median9(rows, alongFrequency.data(), bins);
+
+  float total = 0.0f, percussiveTotal = 0.0f;
+  for (int k = 0; k < bins; ++k) {
+    const float h = alongTime[k] * alongTime[k];
+    const float p = alongFrequency[k] * alongFrequency[k];
+    const float share = (p + 0.5f * FLOOR_POWER) / (h + p + FLOOR_POWER);
+    percussive[k] = share * m[k];
+    harmonic[k] = m[k] - percussive[k];
+    total += m[k];
+    percussiveTotal += percussive[k];
+  }
+  percussiveFraction = total > 0.0f ? percussiveTotal / total : 0.0f;
+}
@@ -0,0 +1,179 @@
+#include "loudness_meter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double BLOCK_SECONDS = 0.1;
+constexpr float ABSOLUTE_GATE = -70.0f; // LUFS
+constexpr float RELATIVE_GATE = -10.0f; // LU under the absolute-gated level
+constexpr float HISTOGRAM_TOP = 10.0f;  // LUFS, louder windows share a bin
+constexpr float HISTOGRAM_STEP = 0.1f;  // LU
+constexpr int HISTOGRAM_BINS =
+    int((HISTOGRAM_TOP - ABSOLUTE_GATE) / HISTOGRAM_STEP);
+
+float lufs(double meanSquare) {
+  if (meanSquare <= 0.0)
+    return LoudnessMeter::SILENT;
+  return std::max(LoudnessMeter::SILENT,
+                  float(-0.691 + 10.0 * std::log10(meanSquare)));
+}
+
+// BS.1770 weight of channel `c` of `channels`, in WAV channel order
+double channel_weight(int c, int channels) {
+  constexpr double SURROUND = 1.41;
+  if (channels == 4)
+    return c >= 2 ? SURROUND : 1.0;
+  if (channels == 5)
+    return c >= 3 ? SURROUND : 1.0;
+  if (channels >= 6 && c == 3)
+    return 0.0; // LFE
+  return channels >= 6 && c > 3 ? SURROUND : 1.0;
+}
+
+int histogram_bin(float loudness) {
+  return std::clamp(int((loudness - ABSOLUTE_GATE) / HISTOGRAM_STEP), 0,
+                    HISTOGRAM_BINS - 1);
+}
+} // namespace
+
+// The K-weighting stages for any sample rate, from the analog prototypes
+// behind the 48 kHz coefficients in BS.1770 (as in libebur128)
+void LoudnessMeter::configure(int sampleRate, int channels) {
+  this->channels = channels;
+  {
+    const double f0 = 1681.974450955533, gainDb = 3.999843853973347;
+    const double q = 0.7071752369554196;
+    const double k = std::tan(M_PI * f0 / sampleRate);
+    const double vh = std::pow(10.0, gainDb / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    const double a0 = 1.0 + k / q + k * k;
+    shelf = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0,
+             (vh - vb * k / q + k * k) / a0, 2.0 * (k * k - 1.0) / a0,
+             (1.0 - k / q + k * k) / a0};
+  }
+  {
+    const double f0 = 38.13547087602444, q = 0.5003270373238773;
+    const double k = std::tan(M_PI * f0 / sampleRate);
+    const double a0 = 1.0 + k / q + k * k;
+    highPass = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0,
+                (1.0 - k / q + k * k) / a0};
+  }
+  state.assign(4 * channels, 0.0);
+  weights.resize(channels);
+  for (int c = 0; c < channels; ++c)
+    weights[c] = channel_weight(c, channels);
+  blockLength = std::max(1, int(std::lround(BLOCK_SECONDS * sampleRate)));
+  blockFill = 0;
+  blockEnergy = 0.0;
+  blocks.fill(0.0);
+  newest = 0;
+  blockCount = 0;
+  momentarySum = shortTermSum = 0.0;
+  session.clear();
+  recent.clear();
+  fade = std::exp(-BLOCK_SECONDS / PROGRAMME_SECONDS);
+  silentBlocks = 0;
+  momentaryLufs = shortTermLufs = integratedLufs = programmeLufs = SILENT;
+}
+
+void LoudnessMeter::process(const float *interleaved, size_t frames) {
+  if (channels == 0)
+    return;
+  for (size_t i = 0; i < frames;) {
+    const size_t n = std::min(frames - i, size_t(blockLength - blockFill));
+    for (int c = 0; c < channels; ++c) {
+      if (weights[c] == 0.0)
+        continue;
+      double *z = &state[4 * c];
+      double energy = 0.0;
+      for (size_t j = i; j < i + n; ++j) {
+        const double x = interleaved[j * channels + c];
+        const double s = shelf.b0 * x + z[0];
+        z[0] = shelf.b1 * x - shelf.a1 * s + z[1];
+        z[1] = shelf.b2 * x - shelf.a2 * s;
+        const double y = highPass.b0 * s + z[2];
+        z[2] = highPass.b1 * s - highPass.a1 * y + z[3];
+        z[3] = highPass.b2 * s - highPass.a2 * y;
+        energy += y * y;
+      }
+      blockEnergy += weights[c] * energy;
+    }
+    blockFill += int(n);
+    i += n;
+    if (blockFill == blockLength)
+      finish_block();
+  }
+}
+
+void LoudnessMeter::finish_block() {
+  const double energy = blockEnergy / blockLength;
+  blockEnergy = 0.0;
+  blockFill = 0;
+
+  // Slot newest + 1 holds the block leaving the 3 s window, slot
+  // newest - 3 the one leaving the 400 ms window.
+  newest = (newest + 1) % SHORT_BLOCKS;
+  const double leavingMomentary =
+      blocks[(newest + SHORT_BLOCKS - MOMENTARY_BLOCKS) % SHORT_BLOCKS];
+  shortTermSum = std::max(0.0, shortTermSum + energy - blocks[newest]);
+  momentarySum = std::max(0.0, momentarySum + energy - leavingMomentary);
+  blocks[newest] = energy;
+  ++blockCount;
+
+  shortTermLufs = lufs(
+      shortTermSum / std::min<long long>(blockCount, SHORT_BLOCKS));
+  if (blockCount < MOMENTARY_BLOCKS)
+    return;
+  const double momentaryEnergy = momentarySum / MOMENTARY_BLOCKS;
+  momentaryLufs = lufs(momentaryEnergy);
+  if (momentaryLufs <= ABSOLUTE_GATE) {
+    // The programme ends with a long enough silence; the next sound
+    // starts a new one.
+    if (++silentBlocks == int(std::lround(RESET_SECONDS / BLOCK_SECONDS))) {
+      recent.clear();
+      programmeLufs = SILENT;
+    }
+    return;
+  }
+  silentBlocks = 0;
+  session.add(momentaryLufs, momentaryEnergy);
+  recent.fade(fade);
+  recent.add(momentaryLufs, momentaryEnergy);
+  integratedLufs = session.gated_loudness();
+  programmeLufs = recent.gated_loudness();
+}
+
+void LoudnessMeter::GatedHistogram::clear() {
+  count.assign(HISTOGRAM_BINS, 0.0);
+  energy.assign(HISTOGRAM_BINS, 0.0);
+}
+
+void LoudnessMeter::GatedHistogram::add(float loudness, double meanSquare) {
+  const int bin = histogram_bin(loudness);
+  count[bin] += 1.0;
+  energy[bin] += meanSquare;
+}
+
+void LoudnessMeter::GatedHistogram::fade(double factor) {
+  for (int b = 0; b < HISTOGRAM_BINS; ++b) {
+    count[b] *= factor;
+    energy[b] *= factor;
+  }
+}
+
+float LoudnessMeter::GatedHistogram::gated_loudness() const {
+  double n = 0.0, sum = 0.0;
+  for (int b = 0; b < HISTOGRAM_BINS; ++b) {
+    n += count[b];
+    sum += energy[b];
+  }
+  if (n <= 0.0)
+    return SILENT;
+  const float threshold = lufs(sum / n) + RELATIVE_GATE;
+  n = sum = 0.0;
+  for (int b = histogram_bin(threshold); b < HISTOGRAM_BINS; ++b) {
+    n += count[b];
+    sum += energy[b];
+  }
+  return n > 0.0 ? lufs(sum / n) : SILENT;
+}
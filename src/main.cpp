@@ -1,12 +1,18 @@
 #include "Camera.h"
 #include "Shader.h"
 #include "audio.h"
+#include "dsp_kernels.h"
+#include "fft_plans.h"
 #include "filemanager.h"
+#include "offline_render.h"
 #include <GLFW/glfw3.h>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <filesystem>
 #include <glad/glad.h>
 #include <iostream>
+#include <string>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "tinyfiledialogs.h"
@@ -22,7 +28,80 @@ void processInput(GLFWwindow *window);
 int SCR_WIDTH = 800;
 int SCR_HEIGHT = 600;
 
-int main() {
+int main(int argc, char **argv) {
+  AudioConfig audioConfig;
+  OfflineRenderOptions renderOptions;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--fftw-patient") {
+      set_fft_patient_planning(true);
+    } else if (arg == "--fft-size" && hasValue) {
+      audioConfig.fft_size = std::atoi(argv[++i]);
+    } else if (arg == "--sample-rate" && hasValue) {
+      audioConfig.sample_rate = std::atoi(argv[++i]);
+    } else if (arg == "--frames" && hasValue) {
+      audioConfig.frames_per_buffer = std::atoi(argv[++i]);
+    } else if (arg == "--channels" && hasValue) {
+      audioConfig.channels = std::atoi(argv[++i]);
+    } else if (arg == "--source" && hasValue) {
+      audioConfig.source = argv[++i];
+    } else if (arg == "--fast") {
+      audioConfig.realtime = false;
+    } else if (arg == "--multires") {
+      audioConfig.multi_resolution = true;
+    } else if (arg == "--render" && hasValue) {
+      renderOptions.input = argv[++i];
+    } else if (arg == "--out" && hasValue) {
+      renderOptions.output = argv[++i];
+    } else if (arg == "--format" && hasValue) {
+      std::string format = argv[++i];
+      if (format == "rgba")
+        renderOptions.format = FrameFormat::Raw;
+      else if (format == "y4m")
+        renderOptions.format = FrameFormat::Y4m;
+      else if (format == "png")
+        renderOptions.format = FrameFormat::Png;
+      else
+        std::cerr << "Unknown frame format: " << format << '\n';
+    } else if (arg == "--fps" && hasValue) {
+      renderOptions.fps = std::atoi(argv[++i]);
+    } else if (arg == "--size" && hasValue) {
+      std::sscanf(argv[++i], "%dx%d", &renderOptions.width,
+                  &renderOptions.height);
+    } else if (arg == "--mode" && hasValue) {
+      renderOptions.shadermode = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown option: " << arg << '\n';
+    }
+  }
+  if (audioConfig.fft_size < 64 || audioConfig.fft_size > 32768 ||
+      audioConfig.sample_rate <= 0 || audioConfig.frames_per_buffer <= 0 ||
+      audioConfig.channels < 1 || audioConfig.channels > 8) {
+    std::cerr << "Invalid audio configuration: fft size must be 64-32768, "
+                 "channels 1-8, sample rate and frames must be positive\n";
+    return -1;
+  }
+
+  if (!renderOptions.input.empty()) {
+    if (renderOptions.output.empty())
+      renderOptions.output =
+          renderOptions.format == FrameFormat::Png ? "frames"
+          : renderOptions.format == FrameFormat::Y4m ? "out.y4m"
+                                                     : "out.rgba";
+    if (renderOptions.fps <= 0 || renderOptions.width <= 0 ||
+        renderOptions.height <= 0 ||
+        (renderOptions.format == FrameFormat::Y4m &&
+         (renderOptions.width % 2 || renderOptions.height % 2))) {
+      std::cerr << "Invalid render settings: fps and size must be positive, "
+                   "y4m needs an even width and height\n";
+      return -1;
+    }
+    renderOptions.fft_size = audioConfig.fft_size;
+    renderOptions.multi_resolution = audioConfig.multi_resolution;
+    return run_offline_render(renderOptions);
+  }
+
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
@@ -61,6 +140,7 @@ int main() {
 
   AudioPlayer player;
   player.init();
+  start_audio(audioConfig);
   bool isrender = false;
   const char *filePath;
   char imagePath[256] = "";
@@ -147,6 +227,200 @@ int main() {
         player.selectedImage = player.textureNames.size() - 1;
         player.loadSelectedTexture();
       }
+      ImGui::Separator();
+      ImGui::Text("Audio");
+      AudioConfig config = get_audio_config();
+      static const char *sources[] = {"portaudio", "synth:sweep",
+                                      "synth:noise", "synth:impulse"};
+      static const int fftSizes[] = {256, 512, 1024, 2048, 4096, 8192, 16384};
+      static const int sampleRates[] = {44100, 48000, 96000};
+      static const int frameCounts[] = {64, 128, 256, 512, 1024};
+      static const int channelCounts[] = {1, 2, 4, 8};
+      bool reconfigure = false;
+      if (ImGui::BeginCombo("Source", config.source.c_str())) {
+        for (const char *name : sources)
+          if (ImGui::Selectable(name, config.source == name)) {
+            config.source = name;
+            reconfigure = true;
+          }
+        ImGui::EndCombo();
+      }
+      if (ImGui::BeginCombo("FFT size",
+                            std::to_string(config.fft_size).c_str())) {
+        for (int n : fftSizes)
+          if (ImGui::Selectable(std::to_string(n).c_str(),
+                                n == config.fft_size)) {
+            config.fft_size = n;
+            reconfigure = true;
+          }
+        ImGui::EndCombo();
+      }
+      if (ImGui::BeginCombo("Sample rate",
+                            std::to_string(config.sample_rate).c_str())) {
+        for (int n : sampleRates)
+          if (ImGui::Selectable(std::to_string(n).c_str(),
+                                n == config.sample_rate)) {
+            config.sample_rate = n;
+            reconfigure = true;
+          }
+        ImGui::EndCombo();
+      }
+      if (ImGui::BeginCombo("Buffer frames",
+                            std::to_string(config.frames_per_buffer).c_str())) {
+        for (int n : frameCounts)
+          if (ImGui::Selectable(std::to_string(n).c_str(),
+                                n == config.frames_per_buffer)) {
+            config.frames_per_buffer = n;
+            reconfigure = true;
+          }
+        ImGui::EndCombo();
+      }
+      if (ImGui::BeginCombo("Channels",
+                            std::to_string(config.channels).c_str())) {
+        for (int n : channelCounts)
+          if (ImGui::Selectable(std::to_string(n).c_str(),
+                                n == config.channels)) {
+            config.channels = n;
+            reconfigure = true;
+          }
+        ImGui::EndCombo();
+      }
+      reconfigure |= ImGui::Checkbox("Multi-resolution (8192/2048/512)",
+                                     &config.multi_resolution);
+      if (reconfigure)
+        reconfigure_audio(config);
+      if (is_reconfiguring_audio())
+        ImGui::Text("Reconfiguring audio...");
+      else if (is_audio_stopped())
+        ImGui::Text("Audio stopped: no configuration could be opened");
+
+      AnalysisSettings analysis = get_analysis_settings();
+      const char *windows[] = {"Rectangular", "Hann", "Blackman-Harris",
+                               "Kaiser"};
+      int window = int(analysis.window);
+      const char *overlaps[] = {"0%", "50%", "75%", "87.5%"};
+      int overlap = 0;
+      while (overlap < 3 && (config.fft_size >> overlap) > analysis.hop_size)
+        ++overlap;
+      bool changed = ImGui::Combo("Window", &window, windows,
+                                  IM_ARRAYSIZE(windows));
+      changed |= ImGui::Combo("Overlap", &overlap, overlaps,
+                              IM_ARRAYSIZE(overlaps));
+      const char *cqOptions[] = {"Off", "12", "24", "36", "48"};
+      int cq = analysis.cq_bins_per_octave / 12;
+      changed |= ImGui::Combo("Constant-Q bins/octave", &cq, cqOptions,
+                              IM_ARRAYSIZE(cqOptions));
+      const int melCounts[] = {0, 40, 64, 128};
+      const char *melOptions[] = {"Off", "40", "64", "128"};
+      int mel = 0;
+      while (mel < 3 && melCounts[mel] < analysis.mel_bands)
+        ++mel;
+      changed |= ImGui::Combo("Mel bands", &mel, melOptions,
+                              IM_ARRAYSIZE(melOptions));
+      const int mfccCounts[] = {0, 13, 20};
+      const char *mfccOptions[] = {"Off", "13", "20"};
+      int mfcc = 0;
+      while (mfcc < 2 && mfccCounts[mfcc] < analysis.mfcc_coefficients)
+        ++mfcc;
+      if (mel > 0)
+        changed |= ImGui::Combo("MFCCs", &mfcc, mfccOptions,
+                                IM_ARRAYSIZE(mfccOptions));
+      changed |= ImGui::Checkbox("Filterbank envelopes (goo)",
+                                 &analysis.band_filterbank);
+      if (changed) {
+        analysis.window = WindowType(window);
+        analysis.hop_size = config.fft_size >> overlap;
+        analysis.cq_bins_per_octave = 12 * cq;
+        analysis.mel_bands = melCounts[mel];
+        analysis.mfcc_coefficients = mfccCounts[mfcc];
+        set_analysis_settings(analysis);
+      }
+      ImGui::Text("Update rate: %.0f Hz",
+                  float(config.sample_rate) / analysis.hop_size);
+      // Comma-separated list of frequencies to follow sample by sample
+      static char trackedHz[128] = "";
+      if (ImGui::InputText("Track Hz", trackedHz, sizeof(trackedHz),
+                           ImGuiInputTextFlags_EnterReturnsTrue)) {
+        std::vector<float> hz;
+        for (char *p = trackedHz, *end; *p; p = end) {
+          float f = std::strtof(p, &end);
+          if (end == p) {
+            ++end;
+            continue;
+          }
+          hz.push_back(f);
+        }
+        set_tracked_frequencies(hz);
+      }
+      for (const TrackedTone &tone : acquire_tones().tones)
+        ImGui::Text("  %.1f Hz: %.1f dBFS, phase %+.2f", tone.frequency,
+                    20.0f * std::log10(tone.magnitude + 1e-9f), tone.phase);
+      AudioStats stats = get_audio_stats();
+      ImGui::Text("Callback: %.1f us (max %.1f us)", stats.callback_last_us,
+                  stats.callback_max_us);
+      ImGui::Text("Dropped blocks: %llu",
+                  (unsigned long long)stats.dropped_blocks);
+      ImGui::Text("FFT planning: %.1f ms (%s wisdom)", stats.plan_ms,
+                  stats.wisdom_loaded ? "warm" : "cold");
+      ImGui::Text("DSP kernels: %s", dsp_kernel_isa());
+      if (analysis.cq_bins_per_octave > 0) {
+        // Kernels are cut to the FFT length below Q * fs / N
+        float q = 1.0f / (std::exp2(1.0f / analysis.cq_bins_per_octave) - 1.0f);
+        ImGui::Text("Constant-Q: %.1f us (%zu coefficients), full Q above "
+                    "%.0f Hz",
+                    stats.cq_us, stats.cq_nonzeros,
+                    q * config.sample_rate / config.fft_size);
+      }
+      if (analysis.mel_bands > 0)
+        ImGui::Text("Mel/MFCC: %.1f us", stats.mel_us);
+      SpectrumView spectrum = acquire_spectrum();
+      const SpectralFeatures &features = spectrum.features;
+      ImGui::Text("Features: %.1f us", stats.features_us);
+      ImGui::Text("  RMS %.3f, peak %.3f, ZCR %.3f", features.rms,
+                  features.peak, features.zero_crossing_rate);
+      ImGui::Text("  Centroid %.0f Hz, rolloff %.0f Hz", features.centroid_hz,
+                  features.rolloff_hz);
+      ImGui::Text("  Flatness %.3f, flux %.3f", features.flatness,
+                  features.flux);
+      Loudness loudness = get_loudness();
+      ImGui::Text("Loudness: M %.1f, S %.1f, I %.1f, P %.1f LUFS",
+                  loudness.momentary_lufs, loudness.short_term_lufs,
+                  loudness.integrated_lufs, loudness.programme_lufs);
+      ImGui::Text("HPSS: %.1f us, percussive %.0f%%", stats.hpss_us,
+                  100.0f * spectrum.percussive_fraction);
+      if (spectrum.pitch_hz > 0.0f) {
+        static const char *notes[] = {"C",  "C#", "D",  "D#", "E",  "F",
+                                      "F#", "G",  "G#", "A",  "A#", "B"};
+        float midi = 69.0f + 12.0f * std::log2(spectrum.pitch_hz / 440.0f);
+        int note = int(std::lround(midi));
+        ImGui::Text("Pitch: %.1f Hz, %s%d %+.0f cents (confidence %.2f, "
+                    "%.1f us)",
+                    spectrum.pitch_hz, notes[note % 12], note / 12 - 1,
+                    100.0f * (midi - note), spectrum.pitch_confidence,
+                    stats.pitch_us);
+      } else {
+        ImGui::Text("Pitch: unvoiced (%.1f us)", stats.pitch_us);
+      }
+      if (spectrum.key >= 0) {
+        static const char *keys[] = {"C",  "C#", "D",  "Eb", "E",  "F",
+                                     "F#", "G",  "Ab", "A",  "Bb", "B"};
+        ImGui::Text("Key: %s %s (%.2f)", keys[spectrum.key % 12],
+                    spectrum.key < 12 ? "major" : "minor",
+                    spectrum.key_strength);
+      }
+      ImGui::Text("Bar mapping: %.1f us", player.barMappingMicros());
+      ImGui::Text("Onsets: %llu (%llu dropped), latency %.1f ms (max %.1f ms)",
+                  (unsigned long long)stats.onsets,
+                  (unsigned long long)stats.onsets_dropped,
+                  stats.onset_latency_ms, stats.onset_latency_max_ms);
+      if (stats.tempo_bpm > 0.0f)
+        ImGui::Text("Tempo: %.1f BPM (confidence %.2f), phase %.2f",
+                    stats.tempo_bpm, stats.tempo_confidence,
+                    player.beatPhase());
+      else
+        ImGui::Text("Tempo: listening...");
+      ImGui::SliderFloat("Beat lead (ms)", &player.beatLeadMs, 0.0f, 150.0f,
+                         "%.0f");
       ImGui::End();
     }
 
@@ -159,6 +433,7 @@ int main() {
     glfwPollEvents();
   }
 
+  stop_audio();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -0,0 +1,73 @@
+#include "mel.h"
+#include <algorithm>
+#include <cmath>
+
+static double hz_to_mel(double f) {
+  return 2595.0 * std::log10(1.0 + f / 700.0);
+}
+static double mel_to_hz(double m) {
+  return 700.0 * (std::pow(10.0, m / 2595.0) - 1.0);
+}
+
+void MelFilterbank::configure(int fftSize, int sampleRate, int bands,
+                              int coefficients, float minFreq,
+                              float maxFreq) {
+  filters.clear();
+  weights.clear();
+  dctRows.clear();
+  dct.clear();
+  if (bands <= 0)
+    return;
+
+  const int bins = fftSize / 2;
+  const double binHz = double(sampleRate) / fftSize;
+  if (maxFreq <= 0.0f || maxFreq > 0.5f * sampleRate)
+    maxFreq = 0.5f * sampleRate;
+  const double melLo = hz_to_mel(minFreq);
+  const double melHi = hz_to_mel(maxFreq);
+
+  // Filter b rises from edge b to edge b + 1 and falls to edge b + 2
+  std::vector<double> edges(bands + 2);
+  for (int i = 0; i < bands + 2; ++i)
+    edges[i] = mel_to_hz(melLo + (melHi - melLo) * i / (bands + 1));
+
+  for (int b = 0; b < bands; ++b) {
+    const double lo = edges[b], centre = edges[b + 1], hi = edges[b + 2];
+    const double norm = 2.0 / (hi - lo);
+    int first = std::max(0, int(std::ceil(lo / binHz)));
+    int last = std::min(bins - 1, int(std::floor(hi / binHz)));
+    SparseBand band{uint32_t(first), 0, uint32_t(weights.size())};
+    for (int k = first; k <= last; ++k) {
+      double f = k * binHz;
+      double w = f <= centre ? (f - lo) / (centre - lo)
+                             : (hi - f) / (hi - centre);
+      weights.push_back(float(std::max(0.0, w) * norm));
+      ++band.length;
+    }
+    // Narrow low bands can fall between two bins; give them the nearer
+    // one rather than leaving them empty.
+    if (band.length == 0) {
+      band.start = std::min(bins - 1, int(std::lround(centre / binHz)));
+      band.length = 1;
+      weights.push_back(float(norm * binHz));
+    }
+    filters.push_back(band);
+  }
+  energies.resize(bands);
+
+  coefficients = std::min(coefficients, bands);
+  for (int c = 0; c < coefficients; ++c) {
+    double scale = std::sqrt((c == 0 ? 1.0 : 2.0) / bands);
+    dctRows.push_back({0, uint32_t(bands), uint32_t(dct.size())});
+    for (int b = 0; b < bands; ++b)
+      dct.push_back(float(scale * std::cos(M_PI * c * (b + 0.5) / bands)));
+  }
+}
+
+void MelFilterbank::process(const float *power, float *melDb, float *mfcc) {
+  sparse_matvec(power, filters.data(), filters.size(), weights.data(),
+                energies.data());
+  power_db(energies.data(), melDb, energies.size(), 1e-10f);
+  if (!dctRows.empty())
+    sparse_matvec(melDb, dctRows.data(), dctRows.size(), dct.data(), mfcc);
+}
@@ -0,0 +1,166 @@
+#include "multi_resolution.h"
+#include "dsp_kernels.h"
+#include "fft_plans.h"
+#include "stft.h"
+#include "triple_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// One resolution: its own cursor into the ring, STFT and FFT plan, and the
+// bands of the stitched output it measures.
+struct MultiResolutionAnalyser::Worker {
+  // A band either averages the bins centred inside it or, when it is
+  // narrower than a bin, interpolates the spectrum at its centre.
+  struct Band {
+    int index; // in the stitched output
+    int first;
+    int count;
+    float centreBin;
+  };
+
+  int fftSize = 0;
+  Stft stft;
+  SampleRing::Cursor cursor;
+  float *input = nullptr;
+  fftwf_complex *output = nullptr;
+  fftwf_plan plan = nullptr;
+  std::vector<float> magnitudes;
+  std::vector<Band> bands;
+  TripleBuffer<std::vector<float>> results; // one value per entry of bands
+  std::thread thread;
+};
+
+std::vector<MultiResolutionAnalyser::Resolution>
+MultiResolutionAnalyser::default_resolutions() {
+  return {{8192, 250.0f}, {2048, 2500.0f}, {512, 24000.0f}};
+}
+
+MultiResolutionAnalyser::MultiResolutionAnalyser(
+    SampleRing &ring, int sampleRate, int channels,
+    std::vector<Resolution> resolutions, int bandsPerOctave, float minHz)
+    : ring(ring), channels(channels) {
+  std::sort(resolutions.begin(), resolutions.end(),
+            [](const Resolution &a, const Resolution &b) {
+              return a.max_hz < b.max_hz;
+            });
+  for (const Resolution &r : resolutions) {
+    auto worker = std::make_unique<Worker>();
+    worker->fftSize = r.fft_size;
+    worker->stft.configure(r.fft_size, std::min(r.fft_size / 4, 512),
+                           WindowType::Hann);
+    worker->cursor = ring.cursor();
+    worker->input = fftwf_alloc_real(channels * r.fft_size);
+    worker->output = fftwf_alloc_complex(r.fft_size / 2 + 1);
+    worker->plan = plan_fft_r2c(r.fft_size, worker->input, worker->output);
+    worker->magnitudes.resize(r.fft_size / 2);
+    workers.push_back(std::move(worker));
+  }
+
+  // Each band goes to the first resolution, longest window first, whose
+  // range covers its centre; the last one takes everything above.
+  for (int b = 0;; ++b) {
+    const float lo = minHz * std::exp2(float(b) / bandsPerOctave);
+    const float hi = minHz * std::exp2(float(b + 1) / bandsPerOctave);
+    if (hi > 0.45f * sampleRate)
+      break;
+    const float centre = std::sqrt(lo * hi);
+    size_t w = 0;
+    while (w + 1 < workers.size() && centre > resolutions[w].max_hz)
+      ++w;
+    Worker &worker = *workers[w];
+    const float binHz = float(sampleRate) / worker.fftSize;
+    const int first = int(std::ceil(lo / binHz));
+    const int last = std::min(int(std::ceil(hi / binHz)) - 1,
+                              worker.fftSize / 2 - 1);
+    worker.bands.push_back({int(bandInfo.size()), first,
+                            std::max(0, last - first + 1), centre / binHz});
+    const int hop = worker.stft.hop_size();
+    bandInfo.push_back({lo, hi, worker.fftSize,
+                        1e3f * (worker.fftSize / 2 + hop) / sampleRate});
+  }
+  for (auto &worker : workers)
+    for (int i = 0; i < 3; ++i)
+      worker->results.slot(i).assign(worker->bands.size(), 0.0f);
+}
+
+MultiResolutionAnalyser::~MultiResolutionAnalyser() {
+  running = false;
+  ring.wake();
+  for (auto &worker : workers) {
+    if (worker->thread.joinable())
+      worker->thread.join();
+    fftwf_destroy_plan(worker->plan);
+    fftwf_free(worker->input);
+    fftwf_free(worker->output);
+  }
+}
+
+void MultiResolutionAnalyser::start() {
+  running = true;
+  for (auto &worker : workers)
+    worker->thread = std::thread(&MultiResolutionAnalyser::run, this,
+                                 std::ref(*worker));
+}
+
+void MultiResolutionAnalyser::run(Worker &worker) {
+  const size_t size = worker.fftSize;
+  const size_t hop = worker.stft.hop_size();
+  while (running.load(std::memory_order_relaxed)) {
+    if (worker.cursor.available() < size) {
+      worker.cursor.wait(running);
+      continue;
+    }
+    if (worker.cursor.available() > size + 4 * hop)
+      worker.cursor.catch_up(size);
+    analyse(worker);
+  }
+}
+
+void MultiResolutionAnalyser::advance_to(uint64_t end) {
+  for (auto &worker : workers)
+    while (worker->cursor.position() + worker->fftSize <= end &&
+           worker->cursor.available() >= size_t(worker->fftSize))
+      analyse(*worker);
+}
+
+void MultiResolutionAnalyser::analyse(Worker &worker) {
+  const int n = worker.fftSize;
+  if (!worker.stft.next_frame(worker.cursor, worker.input, channels)) {
+    worker.cursor.catch_up(n);
+    return;
+  }
+  // The transform is linear, so the downmix can be summed before it
+  for (int c = 1; c < channels; ++c)
+    for (int i = 0; i < n; ++i)
+      worker.input[i] += worker.input[c * n + i];
+  fftwf_execute(worker.plan);
+
+  // The window has unit mean, so 2 / n turns |X| into amplitude
+  const int bins = n / 2;
+  complex_magnitude(&worker.output[0][0], worker.magnitudes.data(), bins,
+                    2.0f / (n * channels));
+  const float *m = worker.magnitudes.data();
+  std::vector<float> &out = worker.results.back();
+  for (size_t i = 0; i < worker.bands.size(); ++i) {
+    const Worker::Band &band = worker.bands[i];
+    if (band.count > 0) {
+      out[i] = array_sum(m + band.first, band.count) / band.count;
+    } else {
+      int k = std::min(int(band.centreBin), bins - 2);
+      float t = band.centreBin - k;
+      out[i] = m[k] + t * (m[k + 1] - m[k]);
+    }
+  }
+  worker.results.publish();
+}
+
+void MultiResolutionAnalyser::stitch(std::vector<float> &values) {
+  values.resize(bandInfo.size());
+  for (auto &worker : workers) {
+    worker->results.update();
+    const std::vector<float> &result = worker->results.front();
+    for (size_t i = 0; i < worker->bands.size(); ++i)
+      values[worker->bands[i].index] = result[i];
+  }
+}
@@ -0,0 +1,443 @@
+#include "offline_render.h"
+#include "audio.h"
+#include "wav_reader.h"
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Receives finished frames as top-down RGBA rows.
+class FrameWriter {
+public:
+  virtual ~FrameWriter() = default;
+  virtual bool write(const uint8_t *rgba) = 0;
+};
+
+// All frames back to back in one file, e.g. for
+// ffmpeg -f rawvideo -pix_fmt rgba -s WxH -r FPS -i out.rgba
+class RawWriter : public FrameWriter {
+public:
+  RawWriter(FILE *file, size_t frameBytes)
+      : file(file), frameBytes(frameBytes) {}
+  ~RawWriter() override { std::fclose(file); }
+
+  bool write(const uint8_t *rgba) override {
+    return std::fwrite(rgba, 1, frameBytes, file) == frameBytes;
+  }
+
+private:
+  FILE *file;
+  size_t frameBytes;
+};
+
+// YUV4MPEG2 stream with full-range BT.601 4:2:0 chroma, which most players
+// and encoders read directly. Width and height must be even.
+class Y4mWriter : public FrameWriter {
+public:
+  Y4mWriter(FILE *file, int width, int height, int fps)
+      : file(file), width(width), height(height),
+        planes(size_t(width) * height * 3 / 2) {
+    std::fprintf(file,
+                 "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+                 width, height, fps);
+  }
+  ~Y4mWriter() override { std::fclose(file); }
+
+  bool write(const uint8_t *rgba) override {
+    uint8_t *y = planes.data();
+    uint8_t *cb = y + size_t(width) * height;
+    uint8_t *cr = cb + size_t(width) * height / 4;
+    for (int row = 0; row < height; ++row) {
+      const uint8_t *p = rgba + size_t(row) * width * 4;
+      for (int x = 0; x < width; ++x, p += 4)
+        y[size_t(row) * width + x] =
+            uint8_t((19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768) >> 16);
+    }
+    // Chroma from the average of each 2x2 block, in 16.16 fixed point
+    for (int row = 0; row < height / 2; ++row) {
+      const uint8_t *p0 = rgba + size_t(2 * row) * width * 4;
+      const uint8_t *p1 = p0 + size_t(width) * 4;
+      for (int x = 0; x < width / 2; ++x, p0 += 8, p1 += 8) {
+        int r = p0[0] + p0[4] + p1[0] + p1[4];
+        int g = p0[1] + p0[5] + p1[1] + p1[5];
+        int b = p0[2] + p0[6] + p1[2] + p1[6];
+        size_t i = size_t(row) * (width / 2) + x;
+        cb[i] = uint8_t(
+            std::clamp((-11059 * r - 21709 * g + 32768 * b) / 4 + 8421376,
+                       0, 16777215) >>
+            16);
+        cr[i] = uint8_t(
+            std::clamp((32768 * r - 27439 * g - 5329 * b) / 4 + 8421376, 0,
+                       16777215) >>
+            16);
+      }
+    }
+    return std::fputs("FRAME\n", file) >= 0 &&
+           std::fwrite(planes.data(), 1, planes.size(), file) == planes.size();
+  }
+
+private:
+  FILE *file;
+  int width, height;
+  std::vector<uint8_t> planes;
+};
+
+// One PNG per frame. The image data goes into stored (uncompressed)
+// deflate blocks: encoding stays a couple of memcpys and checksums per
+// frame, and files are meant to be fed to an encoder anyway.
+class PngWriter : public FrameWriter {
+public:
+  PngWriter(std::filesystem::path directory, int width, int height)
+      : directory(std::move(directory)), width(width), height(height) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      crcTable[i] = c;
+    }
+  }
+
+  bool write(const uint8_t *rgba) override {
+    // Scanlines, each prefixed with filter type 0
+    const size_t stride = size_t(width) * 4;
+    scanlines.resize((stride + 1) * height);
+    for (int row = 0; row < height; ++row) {
+      scanlines[row * (stride + 1)] = 0;
+      std::copy_n(rgba + row * stride, stride,
+                  &scanlines[row * (stride + 1) + 1]);
+    }
+
+    png.clear();
+    static const uint8_t signature[] = {0x89, 'P',  'N',  'G',
+                                        '\r', '\n', 0x1a, '\n'};
+    png.insert(png.end(), std::begin(signature), std::end(signature));
+
+    uint8_t header[13] = {};
+    put32(header, width);
+    put32(header + 4, height);
+    header[8] = 8; // bit depth
+    header[9] = 6; // RGBA
+    chunk("IHDR", header, sizeof(header));
+
+    // zlib stream: header, stored blocks of at most 65535 bytes, Adler-32
+    zlib.clear();
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t offset = 0;
+    do {
+      size_t n = std::min<size_t>(65535, scanlines.size() - offset);
+      bool last = offset + n == scanlines.size();
+      zlib.push_back(last ? 1 : 0);
+      zlib.push_back(uint8_t(n));
+      zlib.push_back(uint8_t(n >> 8));
+      zlib.push_back(uint8_t(~n));
+      zlib.push_back(uint8_t(~n >> 8));
+      zlib.insert(zlib.end(), scanlines.begin() + offset,
+                  scanlines.begin() + offset + n);
+      offset += n;
+    } while (offset < scanlines.size());
+    uint8_t adler[4];
+    put32(adler, adler32(scanlines.data(), scanlines.size()));
+    zlib.insert(zlib.end(), adler, adler + 4);
+    chunk("IDAT", zlib.data(), zlib.size());
+    chunk("IEND", nullptr, 0);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06d.png", index++);
+    FILE *file = std::fopen((directory / name).c_str(), "wb");
+    if (!file)
+      return false;
+    bool ok = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+    return std::fclose(file) == 0 && ok;
+  }
+
+private:
+  static void put32(uint8_t *p, uint32_t v) {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+  }
+
+  static uint32_t adler32(const uint8_t *p, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n > 0) {
+      // Largest run before the sums can overflow 32 bits
+      size_t run = std::min<size_t>(n, 5552);
+      n -= run;
+      while (run--) {
+        a += *p++;
+        b += a;
+      }
+      a %= 65521;
+      b %= 65521;
+    }
+    return (b << 16) | a;
+  }
+
+  uint32_t crc32(const uint8_t *p, size_t n, uint32_t crc) const {
+    while (n--)
+      crc = crcTable[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+  }
+
+  void chunk(const char type[4], const uint8_t *data, size_t size) {
+    uint8_t length[4];
+    put32(length, uint32_t(size));
+    png.insert(png.end(), length, length + 4);
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    if (size)
+      png.insert(png.end(), data, data + size);
+    uint8_t crc[4];
+    put32(crc, ~crc32(&png[start], png.size() - start, 0xffffffffu));
+    png.insert(png.end(), crc, crc + 4);
+  }
+
+  std::filesystem::path directory;
+  int width, height;
+  int index = 0;
+  std::array<uint32_t, 256> crcTable;
+  std::vector<uint8_t> scanlines, zlib, png;
+};
+
+std::unique_ptr<FrameWriter> make_writer(const OfflineRenderOptions &options) {
+  if (options.format == FrameFormat::Png) {
+    std::error_code ec;
+    std::filesystem::create_directories(options.output, ec);
+    if (ec) {
+      std::cerr << "[render] Cannot create " << options.output << ": "
+                << ec.message() << '\n';
+      return nullptr;
+    }
+    return std::make_unique<PngWriter>(options.output, options.width,
+                                       options.height);
+  }
+  FILE *file = std::fopen(options.output.c_str(), "wb");
+  if (!file) {
+    std::cerr << "[render] Cannot open " << options.output << '\n';
+    return nullptr;
+  }
+  if (options.format == FrameFormat::Y4m)
+    return std::make_unique<Y4mWriter>(file, options.width, options.height,
+                                       options.fps);
+  return std::make_unique<RawWriter>(file, size_t(options.width) *
+                                               options.height * 4);
+}
+
+// Surfaceless EGL display and a GL 4.2 core context without any default
+// framebuffer; everything is drawn into an FBO.
+class HeadlessContext {
+public:
+  bool create() {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay)
+      display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+      display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+      std::cerr << "[render] No EGL display available\n";
+      return false;
+    }
+
+    const EGLint configAttribs[] = {EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                    EGL_NONE};
+    EGLConfig config;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &count) ||
+        count == 0 || !eglBindAPI(EGL_OPENGL_API)) {
+      std::cerr << "[render] No EGL config with desktop OpenGL\n";
+      return false;
+    }
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     4,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     2,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+      std::cerr << "[render] Failed to create an OpenGL 4.2 context\n";
+      return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+      std::cerr << "[render] Failed to initialize GLAD\n";
+      return false;
+    }
+    std::cout << "[render] OpenGL " << glGetString(GL_VERSION) << " on "
+              << glGetString(GL_RENDERER) << '\n';
+    return true;
+  }
+
+  ~HeadlessContext() {
+    if (display == EGL_NO_DISPLAY)
+      return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT)
+      eglDestroyContext(display, context);
+    eglTerminate(display);
+  }
+
+private:
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+};
+
+} // namespace
+
+int run_offline_render(const OfflineRenderOptions &options) {
+  WavReader reader;
+  if (auto result = reader.open(options.input); !result) {
+    std::cerr << "[render] " << result.error() << '\n';
+    return -1;
+  }
+  if (reader.channels() > 8) {
+    std::cerr << "[render] " << options.input << " has more than 8 channels\n";
+    return -1;
+  }
+
+  HeadlessContext context;
+  if (!context.create())
+    return -1;
+
+  const int width = options.width;
+  const int height = options.height;
+  GLuint fbo, color;
+  glGenFramebuffers(1, &fbo);
+  glGenRenderbuffers(1, &color);
+  glBindRenderbuffer(GL_RENDERBUFFER, color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "[render] Offscreen framebuffer is incomplete\n";
+    return -1;
+  }
+  glViewport(0, 0, width, height);
+
+  // Two pixel-pack buffers: frame N is read back asynchronously while frame
+  // N-1 is mapped and written, so the GPU never waits for the disk.
+  const size_t frameBytes = size_t(width) * height * 4;
+  GLuint pbo[2];
+  glGenBuffers(2, pbo);
+  for (GLuint buffer : pbo) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  std::unique_ptr<FrameWriter> writer = make_writer(options);
+  if (!writer)
+    return -1;
+
+  AudioConfig config;
+  config.fft_size = options.fft_size;
+  config.multi_resolution = options.multi_resolution;
+  config.sample_rate = reader.sample_rate();
+  config.channels = reader.channels();
+  config.source = "file:" + options.input;
+  start_offline_audio(config);
+
+  AudioPlayer player;
+  player.selectedImage = 0;
+  player.init();
+  player.shadermode = options.shadermode;
+
+  const uint64_t totalFrames = reader.frames() * options.fps /
+                               uint64_t(reader.sample_rate());
+  std::vector<float> samples;
+  std::vector<uint8_t> image(frameBytes);
+  bool ok = true;
+  // Frames handed to the writer so far; frames are written in order, so on
+  // failure this is the index of the one that failed.
+  uint64_t written = 0;
+
+  // Maps the previous frame's pack buffer and hands it, flipped to top-down
+  // rows, to the writer.
+  auto flush = [&](GLuint buffer) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    auto *pixels = static_cast<const uint8_t *>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT));
+    if (!pixels)
+      return false;
+    const size_t stride = size_t(width) * 4;
+    for (int row = 0; row < height; ++row)
+      std::copy_n(pixels + (height - 1 - row) * stride, stride,
+                  image.data() + row * stride);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    if (!writer->write(image.data()))
+      return false;
+    ++written;
+    return true;
+  };
+
+  using clock = std::chrono::steady_clock;
+  const auto start = clock::now();
+  auto lastReport = start;
+  const float dt = 1.0f / options.fps;
+  uint64_t frame = 0;
+  for (; frame < totalFrames && ok; ++frame) {
+    // Feed everything up to this frame's time, then draw the newest
+    // spectrum, exactly as the live loop would see it.
+    uint64_t until = (frame + 1) * uint64_t(reader.sample_rate()) / options.fps;
+    size_t need = size_t(until - reader.position());
+    samples.resize(need * reader.channels());
+    size_t got = reader.read(samples.data(), need);
+    feed_audio(samples.data(), got);
+
+    float time = float(frame) * dt;
+    float amp = get_amplitude();
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    player.render(&amp, &time, dt, width, height);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[frame % 2]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    if (frame > 0)
+      ok = flush(pbo[(frame - 1) % 2]);
+
+    auto now = clock::now();
+    if (now - lastReport >= std::chrono::seconds(1)) {
+      double elapsed = std::chrono::duration<double>(now - start).count();
+      std::cout << "[render] " << frame + 1 << "/" << totalFrames << " frames, "
+                << (frame + 1) / elapsed << " fps\n";
+      lastReport = now;
+    }
+  }
+  if (ok && frame > 0)
+    ok = flush(pbo[(frame - 1) % 2]);
+
+  double elapsed =
+      std::chrono::duration<double>(clock::now() - start).count();
+  double fps = written / std::max(elapsed, 1e-9);
+  std::cout << "[render] " << written << " frames in " << elapsed << " s: "
+            << fps << " fps (" << fps / options.fps << "x real time)\n";
+  if (!ok)
+    std::cerr << "[render] Failed to write frame " << written << '\n';
+
+  stop_audio();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glDeleteBuffers(2, pbo);
+  glDeleteRenderbuffers(1, &color);
+  glDeleteFramebuffers(1, &fbo);
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,70 @@
+#include "onset_detector.h"
+#include "dsp_kernels.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+constexpr float COMPRESSION = 0.3f;   // cube-root-like loudness curve
+constexpr float WINDOW_SECONDS = 1.0f; // span of the threshold's mean
+constexpr float LAMBDA = 1.6f;         // threshold over the mean novelty
+constexpr float FLOOR = 0.004f;        // keeps noise and silence quiet
+constexpr float MIN_INTERVAL = 0.05f;  // seconds between two onsets
+} // namespace
+
+void OnsetDetector::configure(int bins, float hop, float amplitudeScale) {
+  hopSeconds = hop;
+  scale = amplitudeScale;
+  compressed.assign(bins, 0.0f);
+  previous.assign(bins, 0.0f);
+  history.assign(std::max(1, int(std::lround(WINDOW_SECONDS / hop))), 0.0f);
+  historyAt = 0;
+  historySum = 0.0;
+  framesSeen = 0;
+  lastNovelty = 0.0f;
+  lastThreshold = 0.0f;
+  rising = false;
+  framesSinceOnset = INT_MAX / 2;
+  minIntervalFrames = int(std::ceil(MIN_INTERVAL / hop));
+}
+
+std::optional<OnsetDetector::Onset>
+OnsetDetector::process(std::span<const float> magnitudes) {
+  const int n = bins();
+  if (n == 0 || int(magnitudes.size()) != n)
+    return std::nullopt;
+
+  for (int i = 0; i < n; ++i)
+    compressed[i] = magnitudes[i] * scale;
+  pow_positive(compressed.data(), compressed.data(), n, COMPRESSION);
+  float rise = 0.0f;
+  for (int i = 0; i < n; ++i)
+    rise += std::max(0.0f, compressed[i] - previous[i]);
+  compressed.swap(previous);
+  // The first frame has nothing to rise from
+  const float novelty = framesSeen > 0 ? rise / n : 0.0f;
+
+  // The previous frame is an onset if it peaked above its threshold. The
+  // threshold needs a few frames of history before it means anything.
+  std::optional<Onset> onset;
+  ++framesSinceOnset;
+  if (framesSeen > minIntervalFrames + 1 && rising && lastNovelty > novelty &&
+      lastNovelty > lastThreshold &&
+      framesSinceOnset - 1 >= minIntervalFrames) {
+    onset = Onset{1, lastNovelty / lastThreshold};
+    framesSinceOnset = 1;
+  }
+
+  // This frame's threshold comes from the frames before it only
+  const size_t filled = std::min<size_t>(framesSeen, history.size());
+  const float mean = filled ? float(historySum / filled) : 0.0f;
+  lastThreshold = LAMBDA * mean + FLOOR;
+  rising = novelty >= lastNovelty;
+  lastNovelty = novelty;
+
+  historySum += novelty - history[historyAt];
+  history[historyAt] = novelty;
+  historyAt = (historyAt + 1) % history.size();
+  ++framesSeen;
+  return onset;
+}
@@ -0,0 +1,125 @@
+#include "pitch_tracker.h"
+#include "fft_plans.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+constexpr float MIN_HZ = 60.0f;
+constexpr float MAX_HZ = 1500.0f;
+constexpr float THRESHOLD = 0.15f; // YIN's absolute threshold
+constexpr double SILENCE = 1e-6;   // mean square below -60 dBFS
+} // namespace
+
+PitchTracker::~PitchTracker() { destroy(); }
+
+void PitchTracker::destroy() {
+  if (forward)
+    fftwf_destroy_plan(forward);
+  if (inverse)
+    fftwf_destroy_plan(inverse);
+  fftwf_free(input);
+  fftwf_free(spectra);
+  fftwf_free(correlation);
+  forward = inverse = nullptr;
+  input = correlation = nullptr;
+  spectra = nullptr;
+}
+
+void PitchTracker::plan(int sampleRate) {
+  this->sampleRate = sampleRate;
+  minLag = std::max(2, int(sampleRate / MAX_HZ));
+  maxLag = int(std::ceil(sampleRate / MIN_HZ));
+  window = maxLag;
+  // The correlation of the W-sample head with the whole frame never wraps
+  // for lags up to maxLag as long as the transform covers the frame.
+  const int size = int(std::bit_ceil(unsigned(window + maxLag)));
+  if (forward && size == fftSize)
+    return;
+  destroy();
+  fftSize = size;
+  const int bins = fftSize / 2 + 1;
+  input = fftwf_alloc_real(2 * fftSize);
+  spectra = fftwf_alloc_complex(2 * bins);
+  correlation = fftwf_alloc_real(fftSize);
+  forward = plan_fft_many_r2c(fftSize, 2, input, spectra);
+  inverse = plan_fft_c2r(fftSize, spectra, correlation);
+  cmnd.assign(maxLag + 1, 1.0f);
+  f0 = pitchConfidence = 0.0f;
+}
+
+void PitchTracker::process(const float *x) {
+  if (!forward)
+    return;
+  const int length = frame_length();
+  double energy = 0.0;
+  for (int j = 0; j < window; ++j)
+    energy += double(x[j]) * x[j];
+  if (energy < SILENCE * window) {
+    f0 = pitchConfidence = 0.0f;
+    return;
+  }
+
+  // r(tau) = sum_{j < W} x[j] x[j + tau] = IFFT(conj(A) B) / N
+  float *head = input;
+  float *frame = input + fftSize;
+  std::copy_n(x, window, head);
+  std::fill(head + window, head + fftSize, 0.0f);
+  std::copy_n(x, length, frame);
+  std::fill(frame + length, frame + fftSize, 0.0f);
+  fftwf_execute(forward);
+  const int bins = fftSize / 2 + 1;
+  fftwf_complex *a = spectra;
+  fftwf_complex *b = spectra + bins;
+  for (int k = 0; k < bins; ++k) {
+    const float re = a[k][0] * b[k][0] + a[k][1] * b[k][1];
+    const float im = a[k][0] * b[k][1] - a[k][1] * b[k][0];
+    a[k][0] = re;
+    a[k][1] = im;
+  }
+  fftwf_execute(inverse);
+
+  // d(tau) = e(0) + e(tau) - 2 r(tau), with e(tau) the energy of
+  // x[tau, tau + W) slid along one sample at a time
+  const float norm = 1.0f / fftSize;
+  double shifted = energy;
+  double cumulative = 0.0;
+  cmnd[0] = 1.0f;
+  for (int tau = 1; tau <= maxLag; ++tau) {
+    shifted += double(x[tau + window - 1]) * x[tau + window - 1] -
+               double(x[tau - 1]) * x[tau - 1];
+    const double d =
+        std::max(0.0, energy + shifted - 2.0 * norm * correlation[tau]);
+    cumulative += d;
+    cmnd[tau] = cumulative > 0.0 ? float(d * tau / cumulative) : 1.0f;
+  }
+
+  // First dip under the threshold, followed down to its minimum; failing
+  // that, the global minimum, reported as unvoiced
+  int best = -1;
+  for (int tau = minLag; tau <= maxLag; ++tau)
+    if (cmnd[tau] < THRESHOLD) {
+      while (tau + 1 <= maxLag && cmnd[tau + 1] < cmnd[tau])
+        ++tau;
+      best = tau;
+      break;
+    }
+  const bool voiced = best >= 0;
+  if (!voiced)
+    best = int(std::min_element(cmnd.begin() + minLag, cmnd.end()) -
+               cmnd.begin());
+  pitchConfidence = std::clamp(1.0f - cmnd[best], 0.0f, 1.0f);
+  if (!voiced) {
+    f0 = 0.0f;
+    return;
+  }
+
+  float lag = float(best);
+  if (best > minLag && best < maxLag) {
+    const float l = cmnd[best - 1], c = cmnd[best], r = cmnd[best + 1];
+    const float denominator = l - 2.0f * c + r;
+    if (denominator > 0.0f)
+      lag += 0.5f * (l - r) / denominator;
+  }
+  f0 = sampleRate / lag;
+}
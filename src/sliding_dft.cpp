@@ -0,0 +1,80 @@
+#include "sliding_dft.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+// Per-sample damping of the resonators; r^N stays above 0.999 for any
+// window that fits in the history.
+constexpr double DAMPING = 1.0 - 1e-7;
+constexpr int MIN_WINDOW = 16;
+} // namespace
+
+void SlidingDftBank::configure(int sampleRate, float maxWindowSeconds) {
+  this->sampleRate = sampleRate;
+  longestWindow = std::max(MIN_WINDOW, int(maxWindowSeconds * sampleRate));
+  history.assign(std::bit_ceil(size_t(longestWindow) + 1), 0.0f);
+  historyMask = history.size() - 1;
+  position = 0;
+  numTones = 0;
+}
+
+void SlidingDftBank::set_frequencies(std::span<const float> hz) {
+  numTones = 0;
+  for (float f : hz) {
+    if (numTones == MAX_TONES)
+      break;
+    if (!(f > 0.0f) || f >= 0.5f * sampleRate)
+      continue;
+    const int t = numTones++;
+    const int n = std::clamp(int(std::lround(CYCLES * sampleRate / f)),
+                             MIN_WINDOW, longestWindow);
+    const double w = 2.0 * M_PI * f / sampleRate;
+    const double bin = 2.0 * M_PI / n;
+    frequencies[t] = f;
+    windows[t] = n;
+    const double offsets[3] = {0.0, bin, -bin};
+    for (int r = 0; r < 3; ++r) {
+      rotations[t][r] = std::polar(DAMPING, w + offsets[r]);
+      sums[t][r] = 0.0;
+    }
+    // e^{j(w +- bin)N} = e^{jwN}, so one factor serves all three
+    leaving[t] = std::polar(std::pow(DAMPING, n), w * n);
+  }
+  // Restarting from silence means the samples already in the history must
+  // not be subtracted as they leave
+  std::fill(history.begin(), history.end(), 0.0f);
+}
+
+// S[n] = r e^{jw} S[n-1] + x[n] - r^N e^{jwN} x[n-N], which keeps
+// S[n] = sum over the last N samples of x[n-i] r^i e^{jwi}.
+void SlidingDftBank::process(const float *mono, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const float x = mono[i];
+    history[position & historyMask] = x;
+    for (int t = 0; t < numTones; ++t) {
+      const std::complex<double> in =
+          double(x) -
+          leaving[t] * double(history[(position - windows[t]) & historyMask]);
+      for (int r = 0; r < 3; ++r)
+        sums[t][r] = rotations[t][r] * sums[t][r] + in;
+    }
+    ++position;
+  }
+}
+
+// Hann window 0.5 - 0.5 cos(2 pi i / N) applied as a three-tap kernel
+// across neighbouring bins.
+std::complex<double> SlidingDftBank::windowed(int tone) const {
+  return 0.5 * sums[tone][0] - 0.25 * (sums[tone][1] + sums[tone][2]);
+}
+
+float SlidingDftBank::magnitude(int tone) const {
+  // The Hann window's coherent gain is N / 2 and a real sinusoid puts half
+  // its amplitude at +f
+  return float(4.0 * std::abs(windowed(tone)) / windows[tone]);
+}
+
+float SlidingDftBank::phase(int tone) const {
+  return float(std::arg(windowed(tone)));
+}
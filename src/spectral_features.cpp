@@ -0,0 +1,91 @@
+#include "spectral_features.h"
+#include "dsp_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float ROLLOFF = 0.85f;
+constexpr float FLOOR_POWER = 1e-12f; // keeps the log of silent bins finite
+} // namespace
+
+void SpectralFeatureExtractor::configure(int bins, int sampleRate,
+                                         int fftSize) {
+  binHz = float(sampleRate) / fftSize;
+  bassEnd = std::clamp(fftSize / BASS_TOP_DIVISOR, 1, bins - 1);
+  midEnd = std::clamp(fftSize / MID_TOP_DIVISOR, bassEnd + 1, bins);
+  previous.assign(bins, 0.0f);
+  chunks.assign((bins + SPECTRAL_CHUNK - 1) / SPECTRAL_CHUNK, 0.0f);
+}
+
+// A sinusoid of amplitude A puts A^2 / 4 * N * sum(w^2) of power into the
+// bins of one side of an N-point transform of the windowed frame.
+void SpectralFeatureExtractor::set_window(std::span<const float> window) {
+  double energy = 0.0;
+  for (float w : window)
+    energy += double(w) * w;
+  amplitudeScale =
+      energy > 0.0 ? float(4.0 / (double(window.size()) * energy)) : 0.0f;
+}
+
+float SpectralFeatureExtractor::band_level(const float *magnitudes, int begin,
+                                           int end) const {
+  SignalSums sums;
+  signal_sums(magnitudes + begin, end - begin, sums);
+  return std::sqrt(amplitudeScale * sums.squares);
+}
+
+// Walks the chunk sums to the chunk that crosses the threshold, then the
+// bins inside it.
+float SpectralFeatureExtractor::rolloff_bin(const float *magnitudes,
+                                            float total) const {
+  const float threshold = ROLLOFF * total;
+  float below = 0.0f;
+  size_t j = 0;
+  while (j + 1 < chunks.size() && below + chunks[j] < threshold)
+    below += chunks[j++];
+  const size_t end = std::min(previous.size(), (j + 1) * SPECTRAL_CHUNK);
+  for (size_t k = j * SPECTRAL_CHUNK; k < end; ++k) {
+    below += magnitudes[k];
+    if (below >= threshold)
+      return float(k);
+  }
+  return float(end - 1);
+}
+
+void SpectralFeatureExtractor::process(std::span<const float> magnitudes,
+                                       std::span<const float> samples,
+                                       SpectralFeatures &out) {
+  const int bins = this->bins();
+  const float *m = magnitudes.data();
+  SpectralSums sums;
+  spectral_sums(m, previous.data(), bins, FLOOR_POWER, chunks.data(), sums);
+  std::copy_n(m, bins, previous.begin());
+
+  out.mean = sums.magnitude / bins;
+  out.flux = sums.flux / bins;
+  if (sums.magnitude > 0.0f) {
+    out.centroid_hz = binHz * sums.weighted / sums.magnitude;
+    out.rolloff_hz = binHz * rolloff_bin(m, sums.magnitude);
+  } else {
+    out.centroid_hz = out.rolloff_hz = 0.0f;
+  }
+  // Silence would read as perfectly flat; call it 0 instead
+  const float meanPower = sums.power / bins;
+  out.flatness = meanPower > FLOOR_POWER
+                     ? std::min(1.0f, std::exp(sums.log_power / bins) /
+                                          meanPower)
+                     : 0.0f;
+
+  out.bass = band_level(m, 0, bassEnd);
+  out.mid = band_level(m, bassEnd, midEnd);
+  out.treble = band_level(m, midEnd, bins);
+
+  SignalSums signal;
+  signal_sums(samples.data(), samples.size(), signal);
+  const size_t n = std::max<size_t>(1, samples.size());
+  out.rms = std::sqrt(signal.squares / n);
+  out.peak = signal.peak;
+  out.zero_crossing_rate =
+      samples.size() > 1 ? float(signal.crossings) / (samples.size() - 1)
+                         : 0.0f;
+}
@@ -0,0 +1,118 @@
+#include "spectrum_processor.h"
+#include "dsp_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float TAU = 0.05f;        // smoothing time constant in seconds
+constexpr float CALIBRATION_TAU = 10.0f; // seconds to learn the bar units
+constexpr float GATE_LUFS = -70.0f;      // quieter input leaves the gain be
+constexpr float COMP_EXP = 0.3f;    // <1 = stronger compression of spikes
+constexpr float GLOBAL_GAIN = 0.05f; // 0 = silent, 1 = full sensitivity
+} // namespace
+
+SpectrumProcessor::SpectrumProcessor(int bars)
+    : numBars(bars), level(bars), equalised(bars),
+      smoothed(bars), padded(4 * bars) {}
+
+// Places the bar edges on a power curve over the spectrum, or evenly over
+// log-spaced input. Rebuilt whenever the input changes size or kind, e.g.
+// after an FFT size switch.
+void SpectrumProcessor::buildBarEdges(int bins, bool logSpaced) {
+  const float top = float(bins - 1);
+  // Keeps the lowest bars from collapsing to zero width
+  const float minWidth = 1e-3f;
+  edgeBin.resize(numBars + 1);
+  edgeFrac.resize(numBars + 1);
+  invWidth.resize(numBars);
+  edgeIntegral.resize(numBars + 1);
+  float prev = 0.0f;
+  for (int i = 0; i <= numBars; ++i) {
+    float x = logSpaced ? float(i) / numBars * bins
+                        : std::pow(float(i) / numBars, 2.2f) * bins;
+    if (i > 0)
+      x = std::max(x, prev + minWidth);
+    x = std::min(x, top);
+    edgeBin[i] = std::min(int(x), bins - 2);
+    edgeFrac[i] = x - edgeBin[i];
+    if (i > 0)
+      invWidth[i - 1] = x > prev ? 1.0f / (x - prev) : 0.0f;
+    prev = x;
+  }
+  barBins = bins;
+  barsLogSpaced = logSpaced;
+}
+
+void SpectrumProcessor::process(std::span<const float> spectrum,
+                                std::span<const float> logBands,
+                                float momentaryLufs, float programmeLufs,
+                                float dt) {
+  if (spectrum.size() < 2)
+    return;
+  const bool logSpaced = logBands.size() >= 2;
+  const std::span<const float> magnitudes = logSpaced ? logBands : spectrum;
+  const int bins = int(magnitudes.size());
+  if (bins != barBins || logSpaced != barsLogSpaced)
+    buildBarEdges(bins, logSpaced);
+
+  // Each bar is the mean of the spectrum, linearly interpolated between
+  // bin centres, over its fractional range: the difference of a running
+  // integral at its two edges. The edges are sorted, so one vectorised pass
+  // of segment sums over the bins yields the integral at every edge, and
+  // each bar then costs the same however wide it is. Narrow low bars blend
+  // neighbouring bins instead of snapping to one.
+  //
+  // With S(k) = m[0] + ... + m[k], the integral of the interpolated
+  // spectrum from bin 0 to bin k is S(k) - (m[0] + m[k]) / 2.
+  double running = magnitudes[0];
+  int at = 0; // running == S(at)
+  for (int i = 0; i <= numBars; ++i) {
+    int k = edgeBin[i];
+    if (k - at >= 16) {
+      running += array_sum(&magnitudes[at + 1], k - at);
+      at = k;
+    }
+    for (; at < k; ++at) // short low-frequency segments
+      running += magnitudes[at + 1];
+    double t = edgeFrac[i];
+    double m0 = magnitudes[k], m1 = magnitudes[k + 1];
+    edgeIntegral[i] = running - 0.5 * (magnitudes[0] + m0) + t * m0 +
+                      0.5 * t * t * (m1 - m0);
+  }
+  for (int i = 0; i < numBars; ++i) {
+    if (invWidth[i] > 0.0f)
+      level[i] = float(edgeIntegral[i + 1] - edgeIntegral[i]) * invWidth[i];
+    else // pinned to the top bin
+      level[i] = magnitudes[bins - 1];
+  }
+
+  // One gain for all bars. The mean bar level per unit of momentary
+  // loudness only depends on the input's units and spectral balance, so it
+  // is learnt slowly; dividing by it and by the programme loudness puts the
+  // mean bar at 1 whenever the music is at its usual level, for quiet and
+  // loud masters alike, while louder passages still read louder.
+  if (momentaryLufs > GATE_LUFS) {
+    float mean = 0.0f;
+    for (int i = 0; i < numBars; ++i)
+      mean += level[i];
+    mean /= numBars;
+    const float ratio = mean / std::pow(10.0f, momentaryLufs / 20.0f);
+    const float a = std::exp(-dt / CALIBRATION_TAU);
+    calibration = calibration > 0.0f ? a * calibration + (1.0f - a) * ratio
+                                     : ratio;
+  }
+  if (programmeLufs > GATE_LUFS && calibration > 0.0f)
+    gain = 1.0f / (calibration * std::pow(10.0f, programmeLufs / 20.0f));
+  for (int i = 0; i < numBars; ++i)
+    equalised[i] = level[i] * gain;
+  pow_positive(equalised.data(), equalised.data(), numBars, COMP_EXP);
+
+  // One exp per frame; the per-bar work stays multiply-adds.
+  const float alpha = std::exp(-dt / TAU);
+  for (int i = 0; i < numBars; ++i)
+    smoothed[i] =
+        alpha * smoothed[i] + (1.0f - alpha) * GLOBAL_GAIN * equalised[i];
+
+  for (int i = 0; i < numBars; ++i)
+    padded[4 * i] = smoothed[i];
+}
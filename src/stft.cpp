@@ -0,0 +1,85 @@
+#include "stft.h"
+#include "dsp_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+// Zeroth-order modified Bessel function of the first kind, by its power
+// series. Converges quickly for the beta range used by Kaiser windows.
+static double bessel_i0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  double q = x * x / 4.0;
+  for (int k = 1; k < 64; ++k) {
+    term *= q / (double(k) * k);
+    sum += term;
+    if (term < sum * 1e-12)
+      break;
+  }
+  return sum;
+}
+
+std::vector<float> make_window(WindowType type, int size, float kaiserBeta) {
+  std::vector<float> w(size, 1.0f);
+  const double twoPi = 2.0 * M_PI;
+  for (int n = 0; n < size; ++n) {
+    double x = double(n) / size;
+    switch (type) {
+    case WindowType::Rectangular:
+      break;
+    case WindowType::Hann:
+      w[n] = float(0.5 - 0.5 * std::cos(twoPi * x));
+      break;
+    case WindowType::BlackmanHarris:
+      w[n] = float(0.35875 - 0.48829 * std::cos(twoPi * x) +
+                   0.14128 * std::cos(2.0 * twoPi * x) -
+                   0.01168 * std::cos(3.0 * twoPi * x));
+      break;
+    case WindowType::Kaiser: {
+      double r = 2.0 * x - 1.0;
+      w[n] = float(bessel_i0(kaiserBeta * std::sqrt(1.0 - r * r)) /
+                   bessel_i0(kaiserBeta));
+      break;
+    }
+    }
+  }
+
+  double sum = 0.0;
+  for (float v : w)
+    sum += v;
+  float scale = float(size / sum);
+  for (float &v : w)
+    v *= scale;
+  return w;
+}
+
+void Stft::configure(int fftSize, int hopSize, WindowType type,
+                     float kaiserBeta) {
+  this->fftSize = fftSize;
+  this->hopSize = hopSize;
+  windowType = type;
+  window = make_window(type, fftSize, kaiserBeta);
+  frame.assign(fftSize, 0.0f);
+}
+
+bool Stft::next_frame(SampleRing::Cursor &cursor, float *out, int channels,
+                      float *mono) {
+  if (cursor.available() < size_t(fftSize))
+    return false;
+  for (int c = 0; c < channels; ++c) {
+    if (!cursor.peek(frame.data(), fftSize, c))
+      return false;
+    window_multiply(frame.data(), window.data(), out + c * fftSize, fftSize);
+    if (!mono)
+      continue;
+    if (c == 0)
+      std::copy(frame.begin(), frame.end(), mono);
+    else
+      for (int i = 0; i < fftSize; ++i)
+        mono[i] += frame[i];
+  }
+  if (mono && channels > 1)
+    for (int i = 0; i < fftSize; ++i)
+      mono[i] *= 1.0f / channels;
+  cursor.skip(hopSize);
+  return true;
+}
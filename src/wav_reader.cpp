@@ -0,0 +1,160 @@
+#include "wav_reader.h"
+#include "dsp_kernels.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// How far ahead of the read position pages are requested, and how far
+// behind it they are kept before being released.
+constexpr size_t PREFETCH_BYTES = 4 << 20;
+constexpr size_t RETAIN_BYTES = 4 << 20;
+
+static uint32_t read_le(const unsigned char *p, int bytes) {
+  uint32_t v = 0;
+  for (int i = bytes - 1; i >= 0; --i)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+WavReader::~WavReader() { close(); }
+
+void WavReader::close() {
+  if (map)
+    munmap(const_cast<unsigned char *>(map), mapSize);
+  map = nullptr;
+  data = nullptr;
+  mapSize = 0;
+  totalFrames = 0;
+  framePos = 0;
+}
+
+std::expected<void, std::string> WavReader::open(const std::string &path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return std::unexpected("Could not open " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 12) {
+    ::close(fd);
+    return std::unexpected(path + " is not a RIFF/WAVE file");
+  }
+  mapSize = size_t(st.st_size);
+  void *m = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (m == MAP_FAILED) {
+    mapSize = 0;
+    return std::unexpected("Could not map " + path);
+  }
+  map = static_cast<const unsigned char *>(m);
+  madvise(m, mapSize, MADV_SEQUENTIAL);
+
+  if (std::memcmp(map, "RIFF", 4) != 0 || std::memcmp(map + 8, "WAVE", 4) != 0) {
+    close();
+    return std::unexpected(path + " is not a RIFF/WAVE file");
+  }
+
+  bool haveFormat = false;
+  size_t pos = 12;
+  while (pos + 8 <= mapSize) {
+    const unsigned char *chunk = map + pos;
+    size_t size = read_le(chunk + 4, 4);
+    size_t body = pos + 8;
+    size_t avail = mapSize - body;
+    if (std::memcmp(chunk, "fmt ", 4) == 0) {
+      if (size < 16 || size > avail)
+        break;
+      const unsigned char *fmt = map + body;
+      uint32_t tag = read_le(fmt, 2);
+      numChannels = read_le(fmt + 2, 2);
+      sampleRate = read_le(fmt + 4, 4);
+      int bits = read_le(fmt + 14, 2);
+      if (tag == 0xFFFE && size >= 26) // WAVE_FORMAT_EXTENSIBLE: sub-format GUID
+        tag = read_le(fmt + 24, 2);
+      isFloat = tag == 3;
+      if ((tag != 1 && tag != 3) || (isFloat && bits != 32) ||
+          (!isFloat && bits != 16 && bits != 24 && bits != 32) ||
+          numChannels <= 0 || sampleRate <= 0) {
+        close();
+        return std::unexpected(path + ": unsupported sample format");
+      }
+      bytesPerSample = bits / 8;
+      haveFormat = true;
+    } else if (std::memcmp(chunk, "data", 4) == 0) {
+      if (!haveFormat)
+        break;
+      // Recorders that crash leave a bogus size; trust the file length.
+      size = std::min(size, avail);
+      data = map + body;
+      totalFrames = size / (numChannels * bytesPerSample);
+      framePos = 0;
+      prefetchedTo = releasedTo = body;
+      advise(body);
+      return {};
+    }
+    pos = body + size + (size & 1);
+  }
+  close();
+  return std::unexpected(path + ": missing fmt or data chunk");
+}
+
+// Keeps a window of PREFETCH_BYTES requested ahead of `offset` and lets the
+// kernel drop pages more than RETAIN_BYTES behind it.
+void WavReader::advise(size_t offset) {
+  const size_t page = size_t(sysconf(_SC_PAGESIZE));
+  if (offset + PREFETCH_BYTES / 2 > prefetchedTo && prefetchedTo < mapSize) {
+    size_t start = prefetchedTo & ~(page - 1);
+    size_t end = std::min(mapSize, offset + PREFETCH_BYTES);
+    madvise(const_cast<unsigned char *>(map) + start, end - start,
+            MADV_WILLNEED);
+    prefetchedTo = end;
+  }
+  if (offset > releasedTo + 2 * RETAIN_BYTES) {
+    size_t end = (offset - RETAIN_BYTES) & ~(page - 1);
+    size_t start = releasedTo & ~(page - 1);
+    if (end > start)
+      madvise(const_cast<unsigned char *>(map) + start, end - start,
+              MADV_DONTNEED);
+    releasedTo = end;
+  }
+}
+
+size_t WavReader::read(float *out, size_t frames) {
+  if (!data)
+    return 0;
+  frames = std::min<uint64_t>(frames, totalFrames - framePos);
+  const size_t frameBytes = size_t(numChannels) * bytesPerSample;
+  const unsigned char *p = data + framePos * frameBytes;
+  const size_t n = frames * numChannels;
+
+  if (isFloat)
+    std::memcpy(out, p, n * sizeof(float));
+  else if (bytesPerSample == 2)
+    pcm16_to_float(p, out, n);
+  else if (bytesPerSample == 3)
+    pcm24_to_float(p, out, n);
+  else
+    pcm32_to_float(p, out, n);
+
+  framePos += frames;
+  advise(size_t(data - map) + framePos * frameBytes);
+  return frames;
+}
+
+void WavReader::seek(uint64_t frame) {
+  if (!data)
+    return;
+  // Give back everything still held from the old position on, or a file
+  // that loops would keep its whole mapping resident
+  const size_t page = size_t(sysconf(_SC_PAGESIZE));
+  size_t start = releasedTo & ~(page - 1);
+  if (mapSize > start)
+    madvise(const_cast<unsigned char *>(map) + start, mapSize - start,
+            MADV_DONTNEED);
+  framePos = std::min(frame, totalFrames);
+  size_t offset = size_t(data - map) + framePos * numChannels * bytesPerSample;
+  prefetchedTo = releasedTo = offset;
+  advise(offset);
+}